@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Benchmark script for very-small-c-compiler
+# Usage: ./bench.sh [vscc flags...]
+#        VSCC=/path/to/other/vscc ./bench.sh   (compare against another build)
+
+VSCC="${VSCC:-./bin/vscc}"
+
+# Colors for output
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Function to run a single benchmark
+run_bench() {
+    local bench_file="$1"
+
+    # Static instruction count: assembly lines that are neither labels, directives nor blank
+    local instructions
+    instructions=$("$VSCC" "$@" 2>/dev/null \
+        | sed -n '/====== Emitting Assembly =====/,/====== End of Assembly ======/p' \
+        | grep -Ev '^\s*$|^\s*\.|:$|======' | wc -l)
+
+    # Wall time of compiling, assembling and running the program
+    local TIMEFORMAT=%R
+    local seconds exit_code
+    seconds=$( { time "$VSCC" "$@" > /dev/null 2>&1; echo $? > .bench_exit; } 2>&1 )
+    exit_code=$(cat .bench_exit)
+    rm -f .bench_exit
+
+    printf "%-28s exit=%-4s instructions=%-6s time=%ss\n" \
+        "$(basename "$bench_file")" "$exit_code" "$instructions" "$seconds"
+}
+
+echo "========================================"
+echo "  Very Small C Compiler - Benchmarks"
+echo "========================================"
+echo
+
+if [ ! -x "$VSCC" ]; then
+    echo -e "${YELLOW}Error: Compiler not found at $VSCC. Run 'make' first.${NC}"
+    exit 1
+fi
+
+for bench in benchmarks/*.c; do
+    run_bench "$bench" "$@"
+done
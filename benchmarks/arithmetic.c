@@ -0,0 +1,17 @@
+// Benchmark: sample24.c-style arithmetic evaluated in a long loop
+int main() {
+    int a = 42;
+    int b = 13;
+    int c = 7;
+    int d = 3;
+    int i = 0;
+    int result = 0;
+    
+    while (i < 50000000) {
+        result = result + a + b * c - d / 2 + 3 * (a - b) - (a - b) * (c + d) / 5 + (i - (i / 7) * 7);
+        result = result - (a * c + b * d) + (b - d) * 2;
+        i = i + 1;
+    }
+    
+    return result;
+}
@@ -0,0 +1,24 @@
+// Benchmark: recursion 50000 frames deep, in tail position and accumulated, 100M calls
+int sumDown(int n) {
+    if (n == 0) {
+        return 0;
+    }
+    return n + sumDown(n - 1);
+}
+
+int countSteps(int n, int steps) {
+    if (n <= 1) {
+        return steps;
+    }
+    return countSteps(n - 1, steps + 2);
+}
+
+int main() {
+    int i = 0;
+    int total = 0;
+    while (i < 1000) {
+        total = total + sumDown(50000) / 1000000 + countSteps(50000 + i, 0) / 1000;
+        i = i + 1;
+    }
+    return total / 1000;
+}
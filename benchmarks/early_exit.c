@@ -0,0 +1,26 @@
+// Benchmark: hot loops with a rarely taken early return inside them
+int scan(int limit, int key) {
+    int i = 0;
+    int x = 1;
+    while (i < limit) {
+        x = x + 7;
+        if (x > 1000) {
+            x = x - 1000;
+        }
+        if (x == key) {
+            return i;
+        }
+        i = i + 1;
+    }
+    return x;
+}
+
+int main() {
+    int total = 0;
+    int round = 0;
+    while (round < 200) {
+        total = total + scan(1000000, 0 - 1);
+        round = round + 1;
+    }
+    return total;
+}
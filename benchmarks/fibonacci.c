@@ -0,0 +1,11 @@
+// Benchmark: sample28.c with a deeper recursion
+int fibonacci(int n) {
+    if (n <= 1) {
+        return n;
+    } 
+    return fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+int main() {
+    return fibonacci(35);
+}
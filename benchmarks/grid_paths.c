@@ -0,0 +1,14 @@
+// Benchmark: lattice paths through a 15x15 grid by plain double recursion, 310M calls
+int paths(int right, int down) {
+    if (right == 0) {
+        return 1;
+    }
+    if (down == 0) {
+        return 1;
+    }
+    return paths(right - 1, down) + paths(right, down - 1);
+}
+
+int main() {
+    return paths(15, 15) / 1000;
+}
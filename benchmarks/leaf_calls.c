@@ -0,0 +1,26 @@
+// Benchmark: values live across calls to small helpers, 100M iterations
+int scale(int x) {
+    return x * 3;
+}
+
+int clamp(int x, int limit) {
+    if (x > limit) {
+        return x - limit;
+    }
+    return x;
+}
+
+int main() {
+    int i = 0;
+    int sum = 0;
+    int step = 1;
+    while (i < 100000000) {
+        sum = clamp(sum + scale(step), 1000000) + i / 5000000;
+        step = step + 1;
+        if (step > 100) {
+            step = 1;
+        }
+        i = i + 1;
+    }
+    return sum / 10000;
+}
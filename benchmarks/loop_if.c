@@ -0,0 +1,17 @@
+// Benchmark: sample23.c scaled up to long trip counts
+int main() {
+    int x = 300000000;
+    int y = 3;
+    int result = 0;
+    
+    while (x > 0) {
+        if (x > 150000000) {
+            result = result + y * 2;
+        } else {
+            result = result + y;
+        }
+        x = x - 1;
+    }
+    
+    return result;
+}
@@ -0,0 +1,17 @@
+// Benchmark: sample22.c scaled up to long trip counts
+int main() {
+    int i = 0;
+    int j = 0;
+    int count = 0;
+    
+    while (i < 50000) {
+        j = 0;
+        while (j < 10000) {
+            count = count + 1;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    
+    return count;
+}
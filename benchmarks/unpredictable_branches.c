@@ -0,0 +1,27 @@
+// Benchmark: data-dependent conditions on a pseudo-random sequence, 50M iterations
+int main() {
+    int seed = 1;
+    int i = 0;
+    int high = 0;
+    int low = 0;
+    int peak = 0;
+    while (i < 50000000) {
+        // ZX81 generator: seed = (75 * seed + 74) mod 65537
+        seed = seed * 75 + 74;
+        seed = seed - (seed / 65537) * 65537;
+
+        if (seed > 32768) {
+            high = high + 3;
+        } else {
+            high = high - 1;
+        }
+        if (seed < 16384) {
+            low = seed;
+        }
+        if (low > peak) {
+            peak = low;
+        }
+        i = i + 1;
+    }
+    return (high / 1000 + low + peak) / 1000;
+}
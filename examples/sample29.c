@@ -0,0 +1,35 @@
+// Test: More live locals than registers, kept alive across calls
+int add3(int a, int b, int c) {
+    return a + b + c;
+}
+
+int twice(int x) {
+    return x * 2;
+}
+
+int main() {
+    int a = 1;
+    int b = 2;
+    int c = 3;
+    int d = 4;
+    int e = 5;
+    int f = 6;
+    int g = 7;
+    int h = 8;
+    int k = 9;
+    int l = 10;
+    int m = 11;
+    int n = 12;
+    int i = 0;
+    int total = 0;
+
+    while (i < 10) {
+        total = total + add3(a, twice(b), add3(c, d, twice(e))) + f + g + h + k + l + m + n + i;
+        a = a + 1;
+        b = b + 2;
+        n = n - 1;
+        i = i + 1;
+    }
+
+    return total / 8;
+}
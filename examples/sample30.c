@@ -0,0 +1,19 @@
+// Test: Expression trees deeper than the temporary register pool
+int mix(int a, int b, int c, int d) {
+    return (a - b) * (c - d) - (a + b) / (c + d - 1);
+}
+
+int main() {
+    int a = 9;
+    int b = 4;
+    int c = 7;
+    int d = 2;
+    int e = 5;
+    int f = 3;
+    int g = 8;
+    int h = 6;
+    int x = ((a - b) * (c - d) - (e + f) / (g - h)) - (((a + c) - (b + d)) * ((e - f) + (g - h)));
+    int y = mix(a, mix(b, c, d, e), mix(f, g, h, a) - mix(c, d, e, f), h) / (((a - b) + (c - d)) - ((e - f) + (g - h)));
+
+    return x * 3 - y + (a < b) + (c > d) * 2;
+}
@@ -0,0 +1,40 @@
+// Test: Immediate, memory, lea and inc/dec instruction patterns
+int scaled(int a, int b) {
+    return a + b * 4 + (b * 8 + a) - (a * 2 + 3);
+}
+
+int main() {
+    int a = 1;
+    int b = 2;
+    int c = 3;
+    int d = 4;
+    int e = 5;
+    int f = 6;
+    int g = 7;
+    int h = 8;
+    int k = 9;
+    int l = 10;
+    int m = 11;
+    int i = 0;
+
+    while (i < 20) {
+        a = a + 1;
+        b = 1 + b;
+        c = c - 1;
+        d = d + i;
+        e = e - i;
+        f = f + (g * h - 50);
+        g = g - (f / 100);
+        if (5 < i) {
+            h = h + 2;
+        }
+        if (10 >= k) {
+            k = k + scaled(i, 3);
+        }
+        i = i + 1;
+    }
+
+    l = l - 1;
+    m = 1 + m;
+    return (a + b + c + d + e + f / 4 + g + h + k / 16 + l + m + (i - 1)) / 2;
+}
@@ -0,0 +1,41 @@
+// Test: Values kept in registers across calls to helpers with known clobbers
+int square(int x) {
+    return x * x;
+}
+
+int spread(int a, int b) {
+    int p = a + 1;
+    int q = b + 2;
+    int r = a * b;
+    int s = p - q;
+    int t = r + s;
+    int u = t * 2;
+    int v = u - p;
+    int w = v + q;
+    return p + q + r + s + t + u + v + w;
+}
+
+int sumTo(int n) {
+    if (n == 0) {
+        return 0;
+    }
+    return n + sumTo(n - 1);
+}
+
+int mix(int a, int b) {
+    int first = square(a);
+    int second = spread(a, b);
+    return first + second + square(b) + sumTo(a + b);
+}
+
+int main() {
+    int i = 0;
+    int total = 0;
+    int keep = 7;
+    while (i < 6) {
+        total = total + mix(i, keep) + keep;
+        keep = keep + i;
+        i = i + 1;
+    }
+    return total / 16;
+}
@@ -0,0 +1,25 @@
+// Test: Leaf function with more live locals than registers, slots below the stack pointer
+int blend(int a, int b, int c) {
+    int d = a + b;
+    int e = b + c;
+    int f = c + a;
+    int g = d * 2;
+    int h = e * 3;
+    int i = f * 4;
+    int j = g - h;
+    int k = h - i;
+    int l = i - g;
+    int m = j + k + l;
+    int n = ((((a * d) - (b * e)) * ((c * f) - (g * h))) - (((i * j) - (k * l)) * ((m * a) - (b * c)))) / 7;
+    return a + b + c + d + e + f + g + h + i + j + k + l + m + n
+        + (a + (b + (c + (d + (e + (f + (g + (h + (i + (j + (k + (l + m))))))))))));
+}
+
+int answer() {
+    return 42;
+}
+
+int main() {
+    int total = blend(1, 2, 3) + blend(4, 5, 6);
+    return total / 4 + answer();
+}
@@ -0,0 +1,41 @@
+// Test: Single-assignment if/else and if statements turned into conditional moves
+int pick(int a, int b) {
+    int larger = 0;
+    if (a > b) {
+        larger = a;
+    } else {
+        larger = b;
+    }
+    return larger;
+}
+
+int main() {
+    int i = 0;
+    int odd = 0;
+    int flag = 0;
+    int capped = 0;
+    int total = 0;
+    while (i < 20) {
+        if ((i / 2) * 2 == i) {
+            odd = 0;
+        } else {
+            odd = 1;
+        }
+        if (i > 12) {
+            flag = 0;
+        } else {
+            flag = 1;
+        }
+        capped = i * 3;
+        if (capped > 40) {
+            capped = 40 + odd;
+        }
+        if (i - 10) {
+            total = total + pick(i, 7) + capped + flag;
+        } else {
+            total = total - odd;
+        }
+        i = i + 1;
+    }
+    return total / 2;
+}
@@ -0,0 +1,21 @@
+// Constant folding and algebraic identities
+int twice(int x) {
+    return x * 2;
+}
+
+int main() {
+    int a = 5 + 3 * 2 - 1;          // 10
+    int b = (a + 3) + 4;            // a + 7
+    int c = (0 - 7) / 2;            // -3, division truncates toward zero
+    int d = 7 / (0 - 2) * 1;        // -3
+    int e = a * 1 + 0 - (a - a);    // a
+    int f = twice(a) * 0 + (0 + b); // The call is kept
+    int g = (b - 2) - 3 + (2 * a) * 3;
+    int h = (10 > 3) + (4 == 5) * 8 + (2 <= 2) * 16;
+    int i = 3 + a * 1 + 4;
+
+    if (1 < 2) {
+        a = a + 100;
+    }
+    return a + b + c + d + e + f + g + h + i;
+}
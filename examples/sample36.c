@@ -0,0 +1,36 @@
+int pick(int n) {
+    int mode = 3;
+    int scale = 0;
+
+    // Only the then side is reachable, so scale is still constant after the join
+    if (mode > 2) {
+        scale = 4;
+    } else {
+        scale = n;
+    }
+
+    int x = scale * 5;
+    while (mode == 0) {
+        x = x + n;
+    }
+    return x + n;
+}
+
+int main() {
+    int limit = 10;
+    int step = limit / 5;
+    int total = 0;
+    int i = 0;
+
+    while (i < limit) {
+        total = total + step;
+        i = i + 1;
+    }
+
+    if (step == 2) {
+        total = total + pick(1);
+    } else {
+        total = total + 100;
+    }
+    return total;
+}
@@ -0,0 +1,105 @@
+// Divides by constants against idiv with the same divisor as a run-time value
+int byConstant(int n, int d) {
+    if (d == 2) { return n / 2; }
+    if (d == 3) { return n / 3; }
+    if (d == 7) { return n / 7; }
+    if (d == 10) { return n / 10; }
+    if (d == 16) { return n / 16; }
+    if (d == 25) { return n / 25; }
+    if (d == 641) { return n / 641; }
+    if (d == 65536) { return n / 65536; }
+    if (d == 1000000) { return n / 1000000; }
+    if (d == 2147483647) { return n / 2147483647; }
+    if (d == 0 - 3) { return n / (0 - 3); }
+    if (d == 0 - 8) { return n / (0 - 8); }
+    return n / (0 - 1000);
+}
+
+// Same for multiplication, on values that cannot overflow
+int timesConstant(int n, int f) {
+    if (f == 3) { return n * 3; }
+    if (f == 8) { return n * 8; }
+    if (f == 12) { return n * 12; }
+    if (f == 15) { return n * 15; }
+    if (f == 17) { return n * 17; }
+    if (f == 45) { return n * 45; }
+    return n * (0 - 5);
+}
+
+// Samples the whole int range with a stride, plus every dividend around zero
+int divisionErrors(int d) {
+    int errors = 0;
+    int n = 0 - 2147483647 - 1;
+    int stride = 65521;
+    while (n < 2147483647 - stride) {
+        if (byConstant(n, d) != n / d) {
+            errors = errors + 1;
+        }
+        n = n + stride;
+    }
+    n = 0 - 2000;
+    while (n < 2000) {
+        if (byConstant(n, d) != n / d) {
+            errors = errors + 1;
+        }
+        n = n + 1;
+    }
+    if (byConstant(2147483647, d) != 2147483647 / d) {
+        errors = errors + 1;
+    }
+    return errors;
+}
+
+int multiplyErrors(int f) {
+    int errors = 0;
+    int n = 0 - 40000000;
+    while (n < 40000000) {
+        if (timesConstant(n, f) != n * f) {
+            errors = errors + 1;
+        }
+        n = n + 9973;
+    }
+    return errors;
+}
+
+// Divisors come out of a loop, so nothing can know them at compile time
+int nextDivisor(int d) {
+    if (d == 2) { return 3; }
+    if (d == 3) { return 7; }
+    if (d == 7) { return 10; }
+    if (d == 10) { return 16; }
+    if (d == 16) { return 25; }
+    if (d == 25) { return 641; }
+    if (d == 641) { return 65536; }
+    if (d == 65536) { return 1000000; }
+    if (d == 1000000) { return 2147483647; }
+    if (d == 2147483647) { return 0 - 3; }
+    if (d == 0 - 3) { return 0 - 8; }
+    if (d == 0 - 8) { return 0 - 1000; }
+    return 0;
+}
+
+int nextFactor(int f) {
+    if (f == 3) { return 8; }
+    if (f == 8) { return 12; }
+    if (f == 12) { return 15; }
+    if (f == 15) { return 17; }
+    if (f == 17) { return 45; }
+    if (f == 45) { return 0 - 5; }
+    return 0;
+}
+
+int main() {
+    int errors = 0;
+    int d = 2;
+    while (d != 0) {
+        errors = errors + divisionErrors(d);
+        d = nextDivisor(d);
+    }
+    int f = 3;
+    while (f != 0) {
+        errors = errors + multiplyErrors(f);
+        f = nextFactor(f);
+    }
+    return 42 + errors;
+}
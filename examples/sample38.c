@@ -0,0 +1,54 @@
+int sign(int x) {
+    if (x < 0) {
+        return 0 - 1;
+    } else {
+        return 1;
+    }
+    x = x * 1000;
+    return x;
+}
+
+int spin(int n) {
+    int total = 0;
+    while (1) {
+        if (n == 0) {
+            return total;
+        }
+        total = total + n;
+        n = n - 1;
+    }
+    return 0 - 1;
+}
+
+int main() {
+    int result = 5;
+    int debug = 0;
+
+    if (debug) {
+        result = result + sign(0 - 7) * 100;
+    }
+    while (debug) {
+        result = result + 1;
+    }
+
+    // The taken side declares a variable that shadows result, so it keeps its own scope
+    if (1) {
+        int result = 30;
+        debug = result + 2;
+    } else {
+        result = 0;
+    }
+
+    if (0) {
+        result = 99;
+    } else {
+        result = result + debug;
+    }
+
+    if (debug == 32) {
+        result = result + sign(0 - 3) + spin(4);
+        return result;
+        result = 0;
+    }
+    return 1;
+}
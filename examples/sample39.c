@@ -0,0 +1,34 @@
+int noisy(int x) {
+    return x * 3;
+}
+
+int pick(int c) {
+    int x;
+    if (c > 2) {
+        x = c * 2;
+    } else {
+        x = c + 7;
+    }
+
+    int unused = c * 100;
+    int y = 5;
+    y = x + 1;
+
+    // The call stays even though its result is overwritten
+    int t = noisy(c);
+    t = 4;
+    return y + t;
+}
+
+int main() {
+    int total;
+    total = pick(3) + pick(1);
+
+    int scratch = 0;
+    int i = 0;
+    while (i < 5) {
+        scratch = scratch + i;
+        i = i + 1;
+    }
+    return total + i;
+}
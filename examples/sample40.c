@@ -0,0 +1,31 @@
+int mix(int a, int b, int c) {
+    int result = a + b * c + 3 * (a - b);
+
+    if (a > b) {
+        // Reuses a * c from here on, until c changes
+        result = result + a * c;
+        if (a * c > 30) {
+            result = result - (a - b);
+        }
+    } else {
+        return a * c - (a - b);
+    }
+
+    int product = a * c;
+    c = c + 1;
+    result = result + a * c + product;
+
+    // The loop condition reads the value computed before the loop
+    int i = 0;
+    while (i < a - b) {
+        result = result + (a - b) / 2;
+        i = i + 1;
+    }
+    return result;
+}
+
+int main() {
+    int first = mix(9, 4, 3);
+    int second = mix(2, 5, 6);
+    return first + second;
+}
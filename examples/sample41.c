@@ -0,0 +1,33 @@
+int getAnswer() {
+    return 42;
+}
+
+int getValue() {
+    int base = getAnswer();
+    if (base > 40) {
+        return base - 40;
+    }
+    return base;
+}
+
+// Returns a constant too, but only after a loop: calls stay
+int settle(int n) {
+    while (n > 0) {
+        n = n - 3;
+    }
+    return 5;
+}
+
+int square(int x) {
+    return x * x;
+}
+
+int main() {
+    int total = getAnswer() + getValue();
+    int i = 0;
+    while (i < getValue() + 3) {
+        total = total + square(i) + square(i) / 2;
+        i = i + 1;
+    }
+    return total + settle(7) + square(getValue());
+}
@@ -0,0 +1,45 @@
+// Inlining: multiple returns, shadowed locals, calls in conditions and arguments
+int clamp(int x, int lo, int hi) {
+    if (x < lo) {
+        return lo;
+    }
+    if (x > hi) {
+        return hi;
+    }
+    int x2 = x;
+    if (x2 > 0) {
+        int x = x2 * 2;
+        x2 = x - x2;
+    }
+    return x2;
+}
+
+int firstAbove(int n, int limit) {
+    int i = 0;
+    while (i < n) {
+        if (i * i > limit) {
+            return i;
+        }
+        i = i + 1;
+    }
+    return 0 - 1;
+}
+
+int pick(int a, int b) {
+    return firstAbove(a, b);
+}
+
+int twice(int v) {
+    return v + v;
+}
+
+int main() {
+    int x = 5;
+    int total = clamp(x, 0, 3) + clamp(0 - x, 0 - 2, 9) + clamp(x, 0, 10);
+    if (clamp(twice(x), 0, 100) > 9) {
+        total = total + 100;
+    }
+    total = total + pick(10, 20) + firstAbove(3, 50);
+    x = twice(twice(x));
+    return total + x;
+}
@@ -0,0 +1,53 @@
+// Tail calls: recursion in tail position, accumulated results and calls to other functions
+int sumTo(int n, int acc) {
+    if (n == 0) {
+        return acc;
+    }
+    return sumTo(n - 1, acc + n);
+}
+
+int factorial(int n) {
+    if (n <= 1) {
+        return 1;
+    }
+    return n * factorial(n - 1);
+}
+
+int triangle(int n, int step) {
+    if (n <= 0) {
+        return 0;
+    }
+    int next = n - step;
+    return (triangle(next, step) + n);
+}
+
+int countDown(int n, int a, int b) {
+    while (n > 0) {
+        if (a > b) {
+            return countDown(n - 1, b, a);
+        }
+        n = n - 1;
+        a = a + 1;
+    }
+    return a - b;
+}
+
+int halve(int n, int steps) {
+    if (n < 2) {
+        return steps;
+    }
+    return halve(n / 2, steps + 1);
+}
+
+int start(int n) {
+    return halve(sumTo(n, 0), 0);
+}
+
+int main() {
+    int a = sumTo(50000, 0);
+    int b = factorial(10);
+    int c = triangle(40000, 2);
+    int d = countDown(9, 1, 5);
+    int e = start(1000);
+    return a / 1000000 + b / 100000 + c / 1000000 + d + e;
+}
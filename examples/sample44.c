@@ -0,0 +1,43 @@
+// Memoization candidates: recursive functions of one to three arguments, called repeatedly
+int binomial(int n, int k) {
+    if (k == 0) {
+        return 1;
+    }
+    if (k == n) {
+        return 1;
+    }
+    return binomial(n - 1, k - 1) + binomial(n - 1, k);
+}
+
+int tribonacci(int n) {
+    if (n < 2) {
+        return 0;
+    }
+    if (n == 2) {
+        return 1;
+    }
+    return tribonacci(n - 1) + tribonacci(n - 2) + tribonacci(n - 3);
+}
+
+int ways(int amount, int coin, int limit) {
+    if (amount == 0) {
+        return 1;
+    }
+    if (amount < 0) {
+        return 0;
+    }
+    if (coin > limit) {
+        return 0;
+    }
+    return ways(amount - coin, coin, limit) + ways(amount, coin + 1, limit);
+}
+
+int main() {
+    int total = 0;
+    int i = 0;
+    while (i < 5) {
+        total = total + binomial(20 + i, 10) / 1000 + tribonacci(20 + i) / 1000 + ways(30 + i, 1, 6);
+        i = i + 1;
+    }
+    return total;
+}
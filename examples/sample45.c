@@ -0,0 +1,49 @@
+// Specialization: a general function called with the same constant arguments at several sites
+int compute(int mode, int x) {
+    int result = 0;
+    if (mode == 1) {
+        result = x * 3 + 7;
+    } else {
+        if (mode == 2) {
+            result = x * x - 5;
+        } else {
+            if (mode == 3) {
+                int i = 0;
+                while (i < x) {
+                    result = result + i * mode;
+                    i = i + 1;
+                }
+            } else {
+                result = x / 2 + mode;
+            }
+        }
+    }
+    return result;
+}
+
+int power(int base, int exponent) {
+    if (exponent == 0) {
+        return 1;
+    }
+    return base * power(base, exponent - 1);
+}
+
+int scaled(int x, int factor, int limit) {
+    while (x < limit) {
+        x = x * factor;
+        factor = factor + 1;
+    }
+    if (x > limit) {
+        int factor = 2;
+        x = x / factor;
+    }
+    return x;
+}
+
+int main() {
+    int total = compute(3, 10) + compute(3, 20) + compute(3, 5);
+    total = total + compute(1, total) + compute(1, 4) - compute(2, 6);
+    total = total + power(2, 10) / 64 + power(2, 5) + power(3, 4);
+    total = total + scaled(3, 2, 1000) + scaled(5, 2, 1000) + scaled(7, 2, 1000);
+    return total;
+}
@@ -0,0 +1,38 @@
+// Dead functions: never called, only called from dead code, and left behind by inlining
+int unused(int x) {
+    if (x <= 0) {
+        return 0;
+    }
+    return x * 1000 + unused(x - 1);
+}
+
+int unusedCaller(int x) {
+    return unused(x) + 1;
+}
+
+int square(int x) {
+    return x * x;
+}
+
+int neverCalled(int a, int b) {
+    int i = 0;
+    while (i < a) {
+        b = b + square(i);
+        i = i + 1;
+    }
+    return b;
+}
+
+int sumSquares(int n) {
+    int total = 0;
+    int i = 1;
+    while (i <= n) {
+        total = total + square(i);
+        i = i + 1;
+    }
+    return total;
+}
+
+int main() {
+    return sumSquares(9) - square(4);
+}
@@ -0,0 +1,15 @@
+// An inlined body that shadows a parameter after using it
+int g(int p0, int p2) {
+    if (p0) {
+        p0 = p2 + 1;
+        int p2 = 5;
+        p0 = p0 * p2;
+    }
+    return p0;
+}
+
+int main() {
+    int r = g(1, 7);
+    int s = g(0, 3);
+    return r + s;
+}
@@ -0,0 +1,25 @@
+// Dead parameters in front of live ones: each arrives in its own register, none is moved over another
+int pick(int unused0, int live1, int unused2, int unused3, int live4, int unused5) {
+    int total = 0;
+    while (live4 > 0) {
+        total = total + live1;
+        live4 = live4 - 1;
+    }
+    return total;
+}
+
+int scale(int p0, int p1, int p2, int p3, int p4) {
+    int t = p1 + p2;
+    return t * p4;
+}
+
+int main() {
+    int result = 0;
+    int i = 1;
+    while (i < 4) {
+        result = result + pick(i * 100, i, i + 50, i + 60, i + 1, i * 7);
+        result = result + scale(i, i + 1, i + 2, 8, i * 2);
+        i = i + 1;
+    }
+    return result;
+}
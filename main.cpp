@@ -17,22 +17,57 @@ std::string readFile(const std::string& filepath) {
 }
 
 int main(int argc, char* argv[]) {
+    // Options may appear before or after the input file. The level and size mode are set
+    // independently: -Os keeps the last -O0/-O1/-O2 given, or the default -O2, whatever the order.
+    codegen::Options options;
+    std::string inputFile;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            options.optimizationLevel = arg[2] - '0';
+        } else if (arg == "-Os") {
+            options.optimizeSize = true;
+        } else if (arg == "-stats") {
+            options.printStatistics = true;
+        } else if (arg == "-dump-ir") {
+            options.dumpIr = true;
+        } else if (arg == "-inline-report") {
+            options.inlineReport = true;
+        } else if (arg.rfind("-inline-threshold=", 0) == 0) {
+            options.inlineThreshold = std::stoi(arg.substr(18));
+        } else if (arg.rfind("-inline-growth=", 0) == 0) {
+            options.inlineGrowth = std::stoi(arg.substr(15));
+        } else if (arg.rfind("-specialize-limit=", 0) == 0) {
+            options.specializeLimit = std::stoi(arg.substr(18));
+        } else if (arg.rfind("-specialize-growth=", 0) == 0) {
+            options.specializeGrowth = std::stoi(arg.substr(19));
+        } else if (arg == "-memoize") {
+            options.memoize = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            inputFile = arg;
+        }
+    }
+
     // Check if a file was provided
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
+    if (inputFile.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-O0|-O1|-O2] [-Os] [-stats] [-dump-ir] [-inline-report] [-inline-threshold=N] [-inline-growth=N] [-specialize-limit=N] [-specialize-growth=N] [-memoize] <input_file>" << std::endl;
+        std::cerr << "  -Os optimizes for size at the level of the last -O0/-O1/-O2 given, -O2 when there is none" << std::endl;
         return 1;
     }
     
     // Read the source file
-    std::string sourceCode = readFile(argv[1]);
+    std::string sourceCode = readFile(inputFile);
     if (sourceCode.empty()) {
         return 1;
     }
     
-    std::cout << "=> FILE: " << argv[1] << std::endl;
+    std::cout << "=> FILE: " << inputFile << std::endl;
     
     // Compile the source code
-    compiler::Compiler compiler(sourceCode);
+    compiler::Compiler compiler(sourceCode, options);
     
     // Print compilation results
     std::cout << "====== Start of Tokens ======" << std::endl;
@@ -43,10 +78,28 @@ int main(int argc, char* argv[]) {
     compiler.printAST();
     std::cout << "====== End of Parsing =======\n" << std::endl;
 
+    if (options.dumpIr) {
+        std::cout << "====== SSA Form ======" << std::endl;
+        compiler.printIr();
+        std::cout << "====== End of SSA Form ======\n" << std::endl;
+    }
+
     std::cout << "====== Emitting Assembly =====" << std::endl;
     compiler.emitAssembly();
     std::cout << "====== End of Assembly ======\n" << std::endl;
 
+    if (options.inlineReport) {
+        std::cout << "====== Inlining Report =====" << std::endl;
+        compiler.printInlineReport();
+        std::cout << "====== End of Inlining Report ======\n" << std::endl;
+    }
+
+    if (options.printStatistics) {
+        std::cout << "====== Optimization Statistics =====" << std::endl;
+        compiler.printStatistics();
+        std::cout << "====== End of Statistics ======\n" << std::endl;
+    }
+
     std::cout << "====== Assembling and Executing =====" << std::endl;
     int exitCode = compiler.assembleAndExecute("output.s", "output");
     std::cout << "====== End of Execution =====\n" << std::endl;
@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# Code size script for very-small-c-compiler
+# Usage: ./size.sh [vscc flags...]
+#        VSCC=/path/to/other/vscc ./size.sh   (compare against another build)
+
+VSCC="${VSCC:-./bin/vscc}"
+
+# Colors for output
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+TOTAL=0
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+# Function to measure the .text section of a single program
+measure() {
+    local source_file="$1"
+    shift
+
+    "$VSCC" "$source_file" "$@" 2>/dev/null \
+        | sed -n '/====== Emitting Assembly =====/,/====== End of Assembly ======/p' \
+        | grep -v '======' > "$WORKDIR"/output.s
+    as --64 "$WORKDIR"/output.s -o "$WORKDIR"/output.o 2>/dev/null || { echo "$(basename "$source_file"): assembly failed"; return; }
+
+    local text
+    text=$(size -A "$WORKDIR"/output.o | awk '$1 == ".text" { print $2 }')
+    TOTAL=$((TOTAL + text))
+    printf "%-28s text=%s\n" "$(basename "$source_file")" "$text"
+}
+
+echo "========================================"
+echo "  Very Small C Compiler - Code Size"
+echo "========================================"
+echo
+
+if [ ! -x "$VSCC" ]; then
+    echo -e "${YELLOW}Error: Compiler not found at $VSCC. Run 'make' first.${NC}"
+    exit 1
+fi
+
+for example in $(ls examples/*.c | sort -V); do
+    measure "$example" "$@"
+done
+
+echo
+echo "Total .text bytes: $TOTAL"
@@ -0,0 +1,220 @@
+#include "blockLayout.hpp"
+#include <algorithm>
+#include <set>
+
+BlockLayout::BlockLayout() : coldBlocksMoved(0), unreachableBlocksRemoved(0), loopHeadersAligned(0) {}
+
+std::vector<std::string> BlockLayout::run(const std::vector<std::string>& lines, int& labelCounter) {
+    // Directives in front of the entry label stay in front of it
+    std::vector<std::string> header;
+    size_t first = 0;
+    while (first < lines.size() && (lines[first].empty() || lines[first][0] == '.')) {
+        header.push_back(lines[first++]);
+    }
+
+    std::vector<Block> blocks(1);
+    for (size_t i = first; i < lines.size(); i++) {
+        const std::string& line = lines[i];
+        if (line.empty()) {
+            continue;
+        }
+        if (line.back() == ':') {
+            if (!blocks.back().body.empty()) {
+                blocks.emplace_back();
+            }
+            blocks.back().labels.push_back(line.substr(0, line.size() - 1));
+            continue;
+        }
+        blocks.back().body.push_back(line);
+        if (line == "ret" || jumpTarget(line).has_value()) {
+            blocks.emplace_back();
+        }
+    }
+    if (blocks.size() > 1 && blocks.back().labels.empty() && blocks.back().body.empty()) {
+        blocks.pop_back();
+    }
+
+    auto referencedLabels = [&blocks]() {
+        std::set<std::string> referenced;
+        for (const auto& block : blocks) {
+            if (!block.body.empty()) {
+                if (auto target = jumpTarget(block.body.back())) {
+                    referenced.insert(target.value());
+                }
+            }
+        }
+        return referenced;
+    };
+
+    // Unreachable blocks: nothing falls into them and no jump names them, e.g. the jump over
+    // the else branch after a then branch that returned
+    for (bool removed = true; removed;) {
+        removed = false;
+        std::set<std::string> referenced = referencedLabels();
+        for (size_t i = 1; i < blocks.size(); i++) {
+            bool named = std::any_of(blocks[i].labels.begin(), blocks[i].labels.end(),
+                                     [&](const std::string& label) { return referenced.count(label); });
+            if (!named && !fallsThrough(blocks[i - 1])) {
+                blocks.erase(blocks.begin() + i);
+                unreachableBlocksRemoved++;
+                removed = true;
+                break;
+            }
+        }
+    }
+
+    // Early returns: P ends in "jcc N" and falls into C, which leaves the function. C moves to
+    // the end of the function and P jumps to it on the inverted condition, so the hot path
+    // falls through from P into N. Only safe when the last block does not fall off the end.
+    std::vector<Block> cold;
+    if (!fallsThrough(blocks.back())) {
+        std::unordered_map<std::string, const Block*> blockOf;
+        for (const auto& block : blocks) {
+            for (const auto& label : block.labels) {
+                blockOf[label] = &block;
+            }
+        }
+
+        std::vector<Block> hot;
+        hot.push_back(blocks[0]);
+        for (size_t i = 1; i < blocks.size(); i++) {
+            Block& previous = hot.back();
+            const Block& next = i + 1 < blocks.size() ? blocks[i + 1] : blocks[i];
+            std::optional<std::string> target = previous.body.empty() ? std::nullopt : jumpTarget(previous.body.back());
+            bool skipsBlock = i + 1 < blocks.size() && target.has_value() && previous.body.back().rfind("jmp ", 0) != 0 &&
+                              std::find(next.labels.begin(), next.labels.end(), target.value()) != next.labels.end();
+
+            if (!skipsBlock || !leavesFunction(blocks[i], blockOf)) {
+                hot.push_back(blocks[i]);
+                continue;
+            }
+
+            Block moved = blocks[i];
+            if (moved.labels.empty()) {
+                moved.labels.push_back("cold_label_" + std::to_string(labelCounter++));
+            }
+            auto inverted = invertedJump(previous.body.back(), moved.labels.front());
+            if (!inverted.has_value()) {
+                hot.push_back(blocks[i]);
+                continue;
+            }
+            previous.body.back() = inverted.value();
+            cold.push_back(std::move(moved));
+            coldBlocksMoved++;
+        }
+        blocks = std::move(hot);
+    }
+    blocks.insert(blocks.end(), cold.begin(), cold.end());
+
+    // Labels no jump names any more are dropped, except the function's own
+    std::set<std::string> referenced = referencedLabels();
+    for (size_t i = 0; i < blocks.size(); i++) {
+        auto& labels = blocks[i].labels;
+        labels.erase(std::remove_if(labels.begin() + (i == 0 && !labels.empty() ? 1 : 0), labels.end(),
+                                    [&](const std::string& label) { return !referenced.count(label); }),
+                     labels.end());
+    }
+
+    std::vector<std::string> result = header;
+    for (const auto& block : blocks) {
+        for (const auto& label : block.labels) {
+            result.push_back(label + ":");
+        }
+        result.insert(result.end(), block.body.begin(), block.body.end());
+    }
+    return result;
+}
+
+std::vector<std::string> BlockLayout::align(const std::vector<std::string>& lines) {
+    // A label is a loop header when a jump after it in the final order targets it
+    std::set<std::string> seen;
+    std::set<std::string> headers;
+    for (const auto& line : lines) {
+        if (!line.empty() && line.back() == ':') {
+            seen.insert(line.substr(0, line.size() - 1));
+        } else if (auto target = jumpTarget(line); target.has_value() && seen.count(target.value())) {
+            headers.insert(target.value());
+        }
+    }
+
+    // Entries go on a 16-byte boundary; loop headers only when at most 10 padding bytes are
+    // needed, the padding in front of a loop runs once when the loop is entered. A loop starting
+    // at the entry, as a recursive tail call makes one, is aligned already.
+    std::vector<std::string> result = {".p2align 4"};
+    bool atEntry = true;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const std::string& line = lines[i];
+        bool isLabel = !line.empty() && line.back() == ':';
+        bool startsLabels = isLabel && (i == 0 || lines[i - 1].empty() || lines[i - 1].back() != ':');
+        if (startsLabels && !atEntry) {
+            for (size_t j = i; j < lines.size() && !lines[j].empty() && lines[j].back() == ':'; j++) {
+                if (headers.count(lines[j].substr(0, lines[j].size() - 1))) {
+                    result.push_back(".p2align 4,,10");
+                    loopHeadersAligned++;
+                    break;
+                }
+            }
+        }
+        atEntry = atEntry && (isLabel || line.empty() || line[0] == '.');
+        result.push_back(line);
+    }
+    return result;
+}
+
+int BlockLayout::getColdBlocksMoved() const {
+    return coldBlocksMoved;
+}
+
+int BlockLayout::getUnreachableBlocksRemoved() const {
+    return unreachableBlocksRemoved;
+}
+
+int BlockLayout::getLoopHeadersAligned() const {
+    return loopHeadersAligned;
+}
+
+std::optional<std::string> BlockLayout::jumpTarget(const std::string& line) {
+    size_t space = line.find(' ');
+    if (line.empty() || line[0] != 'j' || space == std::string::npos) {
+        return std::nullopt;
+    }
+    return line.substr(space + 1);
+}
+
+std::optional<std::string> BlockLayout::invertedJump(const std::string& line, const std::string& target) {
+    static const std::unordered_map<std::string, std::string> inverse = {
+        {"je", "jne"}, {"jne", "je"}, {"jl", "jge"}, {"jge", "jl"}, {"jle", "jg"}, {"jg", "jle"},
+    };
+    auto it = inverse.find(line.substr(0, line.find(' ')));
+    if (it == inverse.end()) {
+        return std::nullopt;
+    }
+    return it->second + " " + target;
+}
+
+bool BlockLayout::fallsThrough(const Block& block) {
+    if (block.body.empty()) {
+        return true;
+    }
+    const std::string& last = block.body.back();
+    return last != "ret" && last.rfind("jmp ", 0) != 0;
+}
+
+bool BlockLayout::leavesFunction(const Block& block, const std::unordered_map<std::string, const Block*>& blockOf) {
+    if (block.body.empty()) {
+        return false;
+    }
+    if (block.body.back() == "ret") {
+        return true;
+    }
+
+    // In size mode returns jump to the shared epilogue
+    auto target = jumpTarget(block.body.back());
+    if (!target.has_value() || block.body.back().rfind("jmp ", 0) != 0) {
+        return false;
+    }
+    auto it = blockOf.find(target.value());
+    return it != blockOf.end() && !it->second->body.empty() && it->second->body.back() == "ret" &&
+           std::none_of(it->second->body.begin(), it->second->body.end(),
+                        [](const std::string& line) { return jumpTarget(line).has_value(); });
+}
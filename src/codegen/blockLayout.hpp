@@ -0,0 +1,41 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Basic-block layout over the emitted instructions of one function. The function is split into
+   blocks at labels and jumps, giving a control-flow graph whose edges are fall-throughs and jump
+   targets. Static heuristics then pick the fall-through paths: loop back edges are taken (loops
+   are already emitted rotated) and a block that leaves the function right after a conditional
+   branch is an early return, so it is moved behind the hot path with the branch inverted. */
+class BlockLayout {
+public:
+    BlockLayout();
+
+    // Reorders one function, new labels are numbered from labelCounter
+    std::vector<std::string> run(const std::vector<std::string>& lines, int& labelCounter);
+
+    // Aligns the function entry and every loop header, the target of a backward jump
+    std::vector<std::string> align(const std::vector<std::string>& lines);
+
+    int getColdBlocksMoved() const;
+    int getUnreachableBlocksRemoved() const;
+    int getLoopHeadersAligned() const;
+
+private:
+    struct Block {
+        std::vector<std::string> labels;  // Without the trailing ':'
+        std::vector<std::string> body;    // A jump or ret can only be the last line
+    };
+
+    int coldBlocksMoved;
+    int unreachableBlocksRemoved;
+    int loopHeadersAligned;
+
+    static std::optional<std::string> jumpTarget(const std::string& line);
+    static std::optional<std::string> invertedJump(const std::string& line, const std::string& target);
+    static bool fallsThrough(const Block& block);
+    static bool leavesFunction(const Block& block, const std::unordered_map<std::string, const Block*>& blockOf);
+};
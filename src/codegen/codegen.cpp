@@ -3,29 +3,89 @@
 
 namespace codegen {
 
-CodeGenerator::CodeGenerator(const std::unique_ptr<NodeProgram>& program)
-    : ast(program), generated(false) {}
+CodeGenerator::CodeGenerator(const std::unique_ptr<NodeProgram>& program, const Options& options)
+    : ast(program), options(options), generated(false), statistics(), analyses(*program, statistics) {}
 
 std::string CodeGenerator::generate() {
     if (!generated) {
-        analyze();       // Phase 1: Analyze the AST and build the symbol table
-        generateCode();  // Phase 2: Generate assembly code based on the analyzed AST
+        optimize();      // Phase 1: Run the middle-end passes of the optimization level
+        generateCode();  // Phase 2: Allocate registers and generate assembly, callees before callers
         generated = true;
     }
     return asmOutput;
 }
 
-void CodeGenerator::analyze() {
-    VisitorAnalyzer analyzer;
-    analyzer.analyze(*ast);
+const Statistics& CodeGenerator::getStatistics() const {
+    return statistics;
+}
+
+const ir::Module& CodeGenerator::getModule() {
+    return analyses.getIr();
+}
 
-    // Transfer ownership of the analyzed scope structure
-    globalScope = analyzer.releaseRootScope();
+void CodeGenerator::optimize() {
+    PassManager passes(options);
+    passes.run(*ast, analyses, statistics);
 }
 
 void CodeGenerator::generateCode() {
-    VisitorGenerator generator(globalScope.get());
-    asmOutput = generator.generate(*ast);
+    const CallGraph& callGraph = analyses.getCallGraph();
+    auto& functionLiveness = analyses.getLiveness();
+    ScopeNode* globalScope = analyses.getScopes();
+    ScopedTimer timer(statistics, "codegen");
+
+    std::unordered_map<std::string, size_t> functionIndexes;
+    for (size_t i = 0; i < ast->functions.size(); i++) {
+        functionIndexes[ast->functions[i].name] = i;
+    }
+
+    RegisterAllocator allocator;
+    VisitorGenerator generator(globalScope, allocations, options);
+    std::unordered_map<std::string, RegisterSet> clobbers;
+
+    // -memoize: recursive functions that write nothing answer repeated arguments from a table
+    auto memoized = [&](const NodeFunction& function) {
+        return options.memoize && !CallGraph::isExported(function.name) && !function.parameters.empty() &&
+               callGraph.isRecursive(function.name) && callGraph.purityOf(function.name) != Purity::SideEffecting;
+    };
+
+    // Components come callees first, so every call leaving a component already knows exactly
+    // which registers it overwrites. Calls inside a recursive component fall back to the ABI.
+    for (const auto& component : callGraph.components) {
+        RegisterSet componentClobbers;
+        for (const auto& name : component) {
+            allocations[name] = allocator.allocate(functionLiveness[name], clobbers);
+            size_t index = functionIndexes[name];
+            generator.generateFunction(*ast, index, memoized(ast->functions[index]));
+
+            const auto& written = generator.getClobberedRegisters();
+            componentClobbers.insert(written.begin(), written.end());
+        }
+
+        // Callee-saved registers are restored before returning
+        std::erase_if(componentClobbers, RegisterAllocator::isCalleeSaved);
+        for (const auto& name : component) {
+            clobbers[name] = componentClobbers;
+        }
+    }
+
+    asmOutput = generator.assemble(*ast);
+
+    statistics.add("isel", "multiplies-reduced", generator.getMultipliesReduced());
+    statistics.add("isel", "divisions-reduced", generator.getDivisionsReduced());
+    statistics.add("tailcall", "recursive-calls-looped", generator.getRecursiveCallsLooped());
+    statistics.add("tailcall", "sibling-calls-jumped", generator.getSiblingCallsJumped());
+    statistics.add("memoize", "functions-memoized", generator.getFunctionsMemoized());
+
+    const auto& layout = generator.getLayout();
+    statistics.add("layout", "cold-blocks-moved", layout.getColdBlocksMoved());
+    statistics.add("layout", "unreachable-blocks-removed", layout.getUnreachableBlocksRemoved());
+    statistics.add("layout", "loop-headers-aligned", layout.getLoopHeadersAligned());
+
+    const auto& fired = generator.getPeephole().getCounts();
+    for (size_t i = 0; i < peephole::patternCount; i++) {
+        statistics.add("peephole", std::string(peephole::patterns[i].name), fired[i]);
+    }
 }
 
 } // namespace codegen
\ No newline at end of file
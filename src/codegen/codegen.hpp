@@ -3,26 +3,38 @@
 #include <sstream>
 #include <memory>
 #include "../parser/parser.hpp"
+#include "options.hpp"
+#include "statistics.hpp"
+#include "passManager.hpp"
 #include "scopeNode.hpp"
 #include "visitorAnalyzer.hpp"
+#include "visitorLiveness.hpp"
+#include "visitorCallGraph.hpp"
+#include "registerAllocator.hpp"
 #include "visitorGenerator.hpp"
+#include "../ir/ir.hpp"
 
 namespace codegen {
 
 class CodeGenerator {
 public:
-    explicit CodeGenerator(const std::unique_ptr<NodeProgram>& program);
+    CodeGenerator(const std::unique_ptr<NodeProgram>& program, const Options& options);
 
     std::string generate();
+    const Statistics& getStatistics() const;
+    const ir::Module& getModule();  // SSA form of the program as optimized
 
 private:
     const std::unique_ptr<NodeProgram>& ast;
+    Options options;
     std::string asmOutput;
     bool generated;
+    Statistics statistics;
+    AnalysisCache analyses;
 
-    std::unique_ptr<ScopeNode> globalScope;
+    std::unordered_map<std::string, FunctionAllocation> allocations;
 
-    void analyze();       // Phase 1
+    void optimize();      // Phase 1
     void generateCode();  // Phase 2
 };
 
@@ -0,0 +1,103 @@
+#include "instructionSelector.hpp"
+
+namespace isel {
+
+namespace {
+
+// Compile-time checks: the selector must always find a tiling at least as cheap as the fixed
+// per-node templates, and strictly cheaper on the shapes the patterns were written for
+
+struct Tiling {
+    int selected;
+    int naive;
+    std::string_view rootTemplate;
+};
+
+template <typename Build>
+constexpr Tiling tile(Build build, NonTerminal goal = NonTerminal::Reg) {
+    SelectionTree tree;
+    int root = build(tree);
+
+    SelectionTree naive = tree;
+    naive.label(true);
+    tree.label();
+
+    return {tree.cost(root, goal), naive.cost(root, goal), tree.rule(root, goal).asmTemplate};
+}
+
+// x + 1, x in a register: lea instead of materializing both sides
+constexpr Tiling addImmediate = tile([](SelectionTree& t) {
+    return t.add(Op::Add, t.add(Op::Var), t.add(Op::Const, -1, -1, 1));
+});
+static_assert(addImmediate.selected < addImmediate.naive);
+static_assert(addImmediate.rootTemplate == "lea rax, [{0} + {1}]");
+
+// 1 + x is the same tile with the operands exchanged
+constexpr Tiling addImmediateSwapped = tile([](SelectionTree& t) {
+    return t.add(Op::Add, t.add(Op::Const, -1, -1, 1), t.add(Op::Var));
+});
+static_assert(addImmediateSwapped.selected == addImmediate.selected);
+
+// (a * b) + y, y on the stack: memory operand
+constexpr Tiling addMemory = tile([](SelectionTree& t) {
+    int product = t.add(Op::Mul, t.add(Op::Var), t.add(Op::Var));
+    return t.add(Op::Add, product, t.add(Op::Slot));
+});
+static_assert(addMemory.selected < addMemory.naive);
+static_assert(addMemory.rootTemplate == "add rax, {1}");
+
+// a + b * 4: a single lea with a scaled index
+constexpr Tiling addScaled = tile([](SelectionTree& t) {
+    int scaled = t.add(Op::Mul, t.add(Op::Var), t.add(Op::Const, -1, -1, 4));
+    return t.add(Op::Add, t.add(Op::Var), scaled);
+});
+static_assert(addScaled.selected == 1);
+static_assert(addScaled.rootTemplate == "lea rax, [{0} + {1}]");
+
+// (a * b) - 1: dec
+constexpr Tiling decrement = tile([](SelectionTree& t) {
+    int product = t.add(Op::Mul, t.add(Op::Var), t.add(Op::Var));
+    return t.add(Op::Sub, product, t.add(Op::Const, -1, -1, 1));
+});
+static_assert(decrement.selected < decrement.naive);
+static_assert(decrement.rootTemplate == "dec rax");
+
+// 5 < x compares the register against the immediate with the condition mirrored
+constexpr Tiling compareImmediate = tile([](SelectionTree& t) {
+    return t.add(Op::Cmp, t.add(Op::Const, -1, -1, 5), t.add(Op::Var), 0, Condition::Less);
+});
+static_assert(compareImmediate.selected < compareImmediate.naive);
+static_assert(compareImmediate.rootTemplate == "cmp {0}, {1}\nset{cc} al\nmovzx rax, al");
+
+// while (i < n): a bare cmp for the branch, nothing materialized
+constexpr Tiling compareForBranch = tile([](SelectionTree& t) {
+    return t.add(Op::Cmp, t.add(Op::Var), t.add(Op::Var), 0, Condition::Less);
+}, NonTerminal::Flags);
+static_assert(compareForBranch.selected == 1);
+static_assert(compareForBranch.rootTemplate == "cmp {0}, {1}");
+
+// while (n): tested against zero in place
+constexpr Tiling testForBranch = tile([](SelectionTree& t) {
+    return t.add(Op::Var);
+}, NonTerminal::Flags);
+static_assert(testForBranch.rootTemplate == "test {0}, {0}");
+
+// i = i + 1: inc in place
+constexpr Tiling increment = tile([](SelectionTree& t) {
+    return t.add(Op::AddTo, t.add(Op::Var), t.add(Op::Const, -1, -1, 1));
+}, NonTerminal::Stmt);
+static_assert(increment.selected < increment.naive);
+static_assert(increment.rootTemplate == "inc {0}");
+
+// (a + 1) * (b - c / d): the selected tiling wins on every subtree of a mixed tree
+constexpr Tiling mixed = tile([](SelectionTree& t) {
+    int sum = t.add(Op::Add, t.add(Op::Var), t.add(Op::Const, -1, -1, 1));
+    int quotient = t.add(Op::Div, t.add(Op::Var), t.add(Op::Slot));
+    int difference = t.add(Op::Sub, t.add(Op::Var), quotient);
+    return t.add(Op::Mul, sum, difference);
+});
+static_assert(mixed.selected < mixed.naive);
+
+} // namespace
+
+} // namespace isel
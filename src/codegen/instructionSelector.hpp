@@ -0,0 +1,333 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "strengthReduction.hpp"
+
+// Tree-pattern instruction selection (BURS). Expression and assignment trees are labelled
+// bottom-up with the cheapest way to produce every non-terminal at every node, then the
+// generator walks the chosen rules top-down. The rule table is a constant expression,
+// so the labeller runs at compile time too (see the checks in instructionSelector.cpp).
+namespace isel {
+
+enum class Op {
+    Const, Var, Slot, Opaque,         // Leaves: literal, local in a register, local on the stack, call
+    Add, Sub, Mul, Div, Cmp,          // Value operators
+    Store, AddTo, SubTo,              // Assignments: x = e, x = x + e, x = x - e
+    Chain,                            // Rule converting one non-terminal into another
+};
+
+enum class NonTerminal {
+    None,
+    Reg,    // Value in rax
+    Imm,    // Any constant, used as a 32-bit immediate
+    One,    // The constant 1
+    Scale,  // The constant 2, 4 or 8
+    Var,    // Local variable living in a register
+    Mem,    // Local variable in its stack slot
+    Index,  // Var * Scale, an addressing mode index
+    Stmt,   // Assignment performed
+    Flags,  // Condition codes of a comparison, for a conditional jump or move
+    Count,
+};
+
+enum class Constraint {
+    None, IsOne, IsScale, Negatable,
+    ReducibleFactor, PowerOfTwoDivisor, MagicDivisor,  // Strength reduction, see strengthReduction.hpp
+};
+
+enum class Condition { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+struct Rule {
+    NonTerminal result;
+    Op op;
+    NonTerminal left;   // Source non-terminal for chain rules
+    NonTerminal right;
+    Constraint constraint;
+    int cost;
+    std::string_view asmTemplate;  // {0}/{1}: operands, {cc}: condition code, \n between instructions
+    bool naive;                    // One of the fixed per-node templates used before selection
+};
+
+using enum NonTerminal;
+
+// Costs approximate latency plus extra uops: a register ALU op is 1, a load adds 2,
+// a temporary register adds the 1 it takes to copy a value into it
+inline constexpr std::array rules = {
+    // Leaves
+    Rule{Imm,   Op::Const,  None, None, Constraint::None,    0, "{v}", true},
+    Rule{One,   Op::Const,  None, None, Constraint::IsOne,   0, "{v}", false},
+    Rule{Scale, Op::Const,  None, None, Constraint::IsScale, 0, "{v}", false},
+    Rule{Var,   Op::Var,    None, None, Constraint::None,    0, "{v}", true},
+    Rule{Mem,   Op::Slot,   None, None, Constraint::None,    0, "{v}", true},
+    Rule{Reg,   Op::Opaque, None, None, Constraint::None,    0, "",    true},
+    Rule{Index, Op::Mul,    Var,  Scale, Constraint::None,   0, "{0}*{1}", false},
+
+    // Chain rules
+    Rule{Reg, Op::Chain, Imm,   None, Constraint::None, 1, "mov rax, {0}", true},
+    Rule{Reg, Op::Chain, Var,   None, Constraint::None, 1, "mov rax, {0}", true},
+    Rule{Reg, Op::Chain, Mem,   None, Constraint::None, 3, "mov rax, {0}", true},
+    Rule{Reg, Op::Chain, Index, None, Constraint::None, 1, "lea rax, [{0}]", false},
+    Rule{Flags, Op::Chain, Reg, None, Constraint::None, 1, "test rax, rax", false},
+    Rule{Flags, Op::Chain, Var, None, Constraint::None, 1, "test {0}, {0}", false},
+
+    // Addition
+    Rule{Reg, Op::Add, Reg, One,   Constraint::None, 1, "inc rax", false},
+    Rule{Reg, Op::Add, Reg, Imm,   Constraint::None, 1, "add rax, {1}", false},
+    Rule{Reg, Op::Add, Reg, Var,   Constraint::None, 1, "add rax, {1}", false},
+    Rule{Reg, Op::Add, Reg, Mem,   Constraint::None, 3, "add rax, {1}", false},
+    Rule{Reg, Op::Add, Reg, Index, Constraint::None, 1, "lea rax, [rax + {1}]", false},
+    Rule{Reg, Op::Add, Var, Imm,   Constraint::None, 1, "lea rax, [{0} + {1}]", false},
+    Rule{Reg, Op::Add, Var, Var,   Constraint::None, 1, "lea rax, [{0} + {1}]", false},
+    Rule{Reg, Op::Add, Var, Index, Constraint::None, 1, "lea rax, [{0} + {1}]", false},
+    Rule{Reg, Op::Add, Reg, Reg,   Constraint::None, 2, "add {0}, {1}", true},
+
+    // Subtraction
+    Rule{Reg, Op::Sub, Reg, One, Constraint::None,      1, "dec rax", false},
+    Rule{Reg, Op::Sub, Reg, Imm, Constraint::None,      1, "sub rax, {1}", false},
+    Rule{Reg, Op::Sub, Reg, Var, Constraint::None,      1, "sub rax, {1}", false},
+    Rule{Reg, Op::Sub, Reg, Mem, Constraint::None,      3, "sub rax, {1}", false},
+    Rule{Reg, Op::Sub, Var, Imm, Constraint::Negatable, 1, "lea rax, [{0} - {1}]", false},
+    Rule{Reg, Op::Sub, Reg, Reg, Constraint::None,      2, "sub {0}, {1}", true},
+
+    // Multiplication
+    Rule{Reg, Op::Mul, Reg, Imm, Constraint::None, 3, "imul rax, rax, {1}", false},
+    Rule{Reg, Op::Mul, Var, Imm, Constraint::None, 3, "imul rax, {0}, {1}", false},
+    Rule{Reg, Op::Mul, Mem, Imm, Constraint::None, 5, "imul rax, {0}, {1}", false},
+    Rule{Reg, Op::Mul, Reg, Var, Constraint::None, 3, "imul rax, {1}", false},
+    Rule{Reg, Op::Mul, Reg, Mem, Constraint::None, 5, "imul rax, {1}", false},
+    Rule{Reg, Op::Mul, Reg, Reg, Constraint::None, 4, "imul {0}, {1}", true},
+
+    // Multiplication by a constant as shifts, lea and add, expanded from the constant's plan
+    Rule{Reg, Op::Mul, Reg, Imm, Constraint::ReducibleFactor, 2, "", false},
+    Rule{Reg, Op::Mul, Var, Imm, Constraint::ReducibleFactor, 2, "", false},
+
+    // Division
+    Rule{Reg, Op::Div, Reg, Imm, Constraint::PowerOfTwoDivisor, 4, "", false},
+    Rule{Reg, Op::Div, Reg, Imm, Constraint::MagicDivisor, 7, "", false},
+    Rule{Reg, Op::Div, Reg, Var, Constraint::None, 25, "cqo\nidiv {1}", false},
+    Rule{Reg, Op::Div, Reg, Mem, Constraint::None, 27, "cqo\nidiv {1}", false},
+    Rule{Reg, Op::Div, Reg, Imm, Constraint::None, 26, "mov rcx, {1}\ncqo\nidiv rcx", false},
+    Rule{Reg, Op::Div, Reg, Reg, Constraint::None, 26, "cqo\nidiv {1}", true},
+
+    // Comparison, materialized as 0 or 1
+    Rule{Reg, Op::Cmp, Reg, Imm, Constraint::None, 3, "cmp rax, {1}\nset{cc} al\nmovzx rax, al", false},
+    Rule{Reg, Op::Cmp, Reg, Var, Constraint::None, 3, "cmp rax, {1}\nset{cc} al\nmovzx rax, al", false},
+    Rule{Reg, Op::Cmp, Reg, Mem, Constraint::None, 5, "cmp rax, {1}\nset{cc} al\nmovzx rax, al", false},
+    Rule{Reg, Op::Cmp, Var, Imm, Constraint::None, 3, "cmp {0}, {1}\nset{cc} al\nmovzx rax, al", false},
+    Rule{Reg, Op::Cmp, Var, Var, Constraint::None, 3, "cmp {0}, {1}\nset{cc} al\nmovzx rax, al", false},
+    Rule{Reg, Op::Cmp, Mem, Imm, Constraint::None, 5, "cmp {0}, {1}\nset{cc} al\nmovzx rax, al", false},
+    Rule{Reg, Op::Cmp, Reg, Reg, Constraint::None, 4, "cmp {0}, {1}\nset{cc} al\nmovzx rax, al", true},
+
+    // Comparison feeding a conditional jump or move, only the flags are set
+    Rule{Flags, Op::Cmp, Reg, Imm, Constraint::None, 1, "cmp rax, {1}", false},
+    Rule{Flags, Op::Cmp, Reg, Var, Constraint::None, 1, "cmp rax, {1}", false},
+    Rule{Flags, Op::Cmp, Reg, Mem, Constraint::None, 3, "cmp rax, {1}", false},
+    Rule{Flags, Op::Cmp, Var, Imm, Constraint::None, 1, "cmp {0}, {1}", false},
+    Rule{Flags, Op::Cmp, Var, Var, Constraint::None, 1, "cmp {0}, {1}", false},
+    Rule{Flags, Op::Cmp, Mem, Imm, Constraint::None, 3, "cmp {0}, {1}", false},
+    Rule{Flags, Op::Cmp, Reg, Reg, Constraint::None, 2, "cmp {0}, {1}", false},
+
+    // Assignments
+    Rule{Stmt, Op::Store, Var, Reg, Constraint::None, 1, "mov {0}, rax", true},
+    Rule{Stmt, Op::Store, Mem, Reg, Constraint::None, 2, "mov {0}, rax", true},
+    Rule{Stmt, Op::Store, Var, Imm, Constraint::None, 1, "mov {0}, {1}", false},
+    Rule{Stmt, Op::Store, Mem, Imm, Constraint::None, 2, "mov {0}, {1}", false},
+    Rule{Stmt, Op::Store, Var, Var, Constraint::None, 1, "mov {0}, {1}", false},
+    Rule{Stmt, Op::AddTo, Var, One, Constraint::None, 1, "inc {0}", false},
+    Rule{Stmt, Op::AddTo, Var, Imm, Constraint::None, 1, "add {0}, {1}", false},
+    Rule{Stmt, Op::AddTo, Var, Var, Constraint::None, 1, "add {0}, {1}", false},
+    Rule{Stmt, Op::AddTo, Var, Reg, Constraint::None, 1, "add {0}, rax", true},
+    Rule{Stmt, Op::AddTo, Mem, One, Constraint::None, 3, "inc {0}", false},
+    Rule{Stmt, Op::AddTo, Mem, Imm, Constraint::None, 3, "add {0}, {1}", false},
+    Rule{Stmt, Op::AddTo, Mem, Var, Constraint::None, 3, "add {0}, {1}", false},
+    Rule{Stmt, Op::AddTo, Mem, Reg, Constraint::None, 3, "add {0}, rax", true},
+    Rule{Stmt, Op::SubTo, Var, One, Constraint::None, 1, "dec {0}", false},
+    Rule{Stmt, Op::SubTo, Var, Imm, Constraint::None, 1, "sub {0}, {1}", false},
+    Rule{Stmt, Op::SubTo, Var, Var, Constraint::None, 1, "sub {0}, {1}", false},
+    Rule{Stmt, Op::SubTo, Var, Reg, Constraint::None, 1, "sub {0}, rax", true},
+    Rule{Stmt, Op::SubTo, Mem, One, Constraint::None, 3, "dec {0}", false},
+    Rule{Stmt, Op::SubTo, Mem, Imm, Constraint::None, 3, "sub {0}, {1}", false},
+    Rule{Stmt, Op::SubTo, Mem, Var, Constraint::None, 3, "sub {0}, {1}", false},
+    Rule{Stmt, Op::SubTo, Mem, Reg, Constraint::None, 3, "sub {0}, rax", true},
+};
+
+inline constexpr int unreachable = std::numeric_limits<int>::max() / 4;
+inline constexpr int nonTerminalCount = static_cast<int>(NonTerminal::Count);
+
+struct TreeNode {
+    Op op;
+    int left = -1;
+    int right = -1;
+    int64_t value = 0;                     // Constant value of Const leaves
+    Condition condition = Condition::Equal;
+
+    // Labelling result: cheapest rule (index into rules) per non-terminal
+    std::array<int, nonTerminalCount> cost{};
+    std::array<int, nonTerminalCount> rule{};
+    std::array<bool, nonTerminalCount> swapped{};  // Rule matched with the operands exchanged
+};
+
+// Constrained rules whose template depends on the constant, see expandedTemplate
+constexpr bool isStrengthReduction(Constraint constraint) {
+    return constraint == Constraint::ReducibleFactor || constraint == Constraint::PowerOfTwoDivisor ||
+           constraint == Constraint::MagicDivisor;
+}
+
+// Rules trading code size for speed, skipped when optimizing for size
+constexpr bool growsCode(Constraint constraint) {
+    return constraint == Constraint::MagicDivisor;
+}
+
+inline std::string expandedTemplate(Constraint constraint, int64_t constant) {
+    if (constraint == Constraint::ReducibleFactor) {
+        return multiplyTemplate(planMultiply(constant));
+    }
+    return divisionTemplate(planDivision(constant));
+}
+
+constexpr bool isCommutative(Op op) {
+    // Cmp is commutative once the condition is mirrored, which the generator does on emission
+    return op == Op::Add || op == Op::Mul || op == Op::Cmp;
+}
+
+constexpr Condition mirrored(Condition condition) {
+    switch (condition) {
+        case Condition::Less:         return Condition::Greater;
+        case Condition::LessEqual:    return Condition::GreaterEqual;
+        case Condition::Greater:      return Condition::Less;
+        case Condition::GreaterEqual: return Condition::LessEqual;
+        default:                      return condition;
+    }
+}
+
+constexpr Condition negated(Condition condition) {
+    switch (condition) {
+        case Condition::Equal:        return Condition::NotEqual;
+        case Condition::NotEqual:     return Condition::Equal;
+        case Condition::Less:         return Condition::GreaterEqual;
+        case Condition::LessEqual:    return Condition::Greater;
+        case Condition::Greater:      return Condition::LessEqual;
+        case Condition::GreaterEqual: return Condition::Less;
+        default:                      return condition;
+    }
+}
+
+class SelectionTree {
+public:
+    /* Children must be added before their parent, so index order is a bottom-up order */
+    constexpr int add(Op op, int left = -1, int right = -1, int64_t value = 0, Condition condition = Condition::Equal) {
+        TreeNode node;
+        node.op = op;
+        node.left = left;
+        node.right = right;
+        node.value = value;
+        node.condition = condition;
+        nodes.push_back(node);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    /* Label every node; naiveOnly restricts the tiling to the fixed per-node templates */
+    constexpr void label(bool naiveOnly = false, bool optimizeSize = false) {
+        for (auto& node : nodes) {
+            labelNode(node, naiveOnly, optimizeSize);
+        }
+    }
+
+    constexpr const TreeNode& node(int index) const { return nodes[index]; }
+    constexpr int size() const { return static_cast<int>(nodes.size()); }
+
+    constexpr int cost(int index, NonTerminal nt) const {
+        return nodes[index].cost[static_cast<int>(nt)];
+    }
+
+    constexpr const Rule& rule(int index, NonTerminal nt) const {
+        return rules[nodes[index].rule[static_cast<int>(nt)]];
+    }
+
+    constexpr bool swapped(int index, NonTerminal nt) const {
+        return nodes[index].swapped[static_cast<int>(nt)];
+    }
+
+private:
+    std::vector<TreeNode> nodes;
+
+    static constexpr bool satisfies(Constraint constraint, const TreeNode& node) {
+        switch (constraint) {
+            case Constraint::IsOne:     return node.value == 1;
+            case Constraint::IsScale:   return node.value == 2 || node.value == 4 || node.value == 8;
+            case Constraint::Negatable: return node.value != std::numeric_limits<int32_t>::min();
+            case Constraint::ReducibleFactor:   return node.op == Op::Const && planMultiply(node.value).kind != MultiplyKind::None;
+            case Constraint::PowerOfTwoDivisor: return node.op == Op::Const && planDivision(node.value).kind == DivisionKind::PowerOfTwo;
+            case Constraint::MagicDivisor:      return node.op == Op::Const && planDivision(node.value).kind == DivisionKind::Magic;
+            default:                    return true;
+        }
+    }
+
+    constexpr int operandCost(int index, NonTerminal nt) const {
+        if (nt == NonTerminal::None) {
+            return 0;
+        }
+        return index < 0 ? unreachable : cost(index, nt);
+    }
+
+    constexpr void labelNode(TreeNode& node, bool naiveOnly, bool optimizeSize) {
+        node.cost.fill(unreachable);
+        node.rule.fill(-1);
+        node.swapped.fill(false);
+
+        auto record = [&node](size_t ruleIndex, int cost, bool swapped) {
+            int result = static_cast<int>(rules[ruleIndex].result);
+            if (cost < node.cost[result]) {
+                node.cost[result] = cost;
+                node.rule[result] = static_cast<int>(ruleIndex);
+                node.swapped[result] = swapped;
+            }
+        };
+
+        for (size_t i = 0; i < rules.size(); i++) {
+            const Rule& rule = rules[i];
+            if (rule.op != node.op || (naiveOnly && !rule.naive) || (optimizeSize && growsCode(rule.constraint))) {
+                continue;
+            }
+
+            bool leaf = rule.left == NonTerminal::None;
+            if (leaf) {
+                if (satisfies(rule.constraint, node)) {
+                    record(i, rule.cost, false);
+                }
+                continue;
+            }
+
+            // Constraints on a binary pattern apply to its right operand (the constant),
+            // which is the left child when the operands are exchanged
+            if (rule.constraint == Constraint::None || satisfies(rule.constraint, nodes[node.right])) {
+                record(i, rule.cost + operandCost(node.left, rule.left) + operandCost(node.right, rule.right), false);
+            }
+            if (isCommutative(node.op) && (rule.constraint == Constraint::None || satisfies(rule.constraint, nodes[node.left]))) {
+                record(i, rule.cost + operandCost(node.right, rule.left) + operandCost(node.left, rule.right), true);
+            }
+        }
+
+        // Close over chain rules until no non-terminal gets cheaper
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t i = 0; i < rules.size(); i++) {
+                const Rule& rule = rules[i];
+                if (rule.op != Op::Chain || (naiveOnly && !rule.naive)) {
+                    continue;
+                }
+                int cost = node.cost[static_cast<int>(rule.left)] + rule.cost;
+                if (cost < node.cost[static_cast<int>(rule.result)]) {
+                    record(i, cost, false);
+                    changed = true;
+                }
+            }
+        }
+    }
+};
+
+} // namespace isel
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace codegen {
+
+// Code generation settings chosen on the command line
+struct Options {
+    int optimizationLevel = 2;     // -O0, -O1, -O2; the default optimizes fully
+    bool optimizeSize = false;     // -Os: prefer the shortest encodings over the fastest ones
+    bool printStatistics = false;  // -stats: report what each optimization did
+    bool dumpIr = false;           // -dump-ir: print the SSA form of every function
+    bool inlineReport = false;     // -inline-report: list every call the inliner considered
+    int inlineThreshold = 20;      // -inline-threshold=N: largest callee cost still inlined
+    int inlineGrowth = 100;        // -inline-growth=N: percent the program may grow by inlining
+    int specializeLimit = 8;       // -specialize-limit=N: most clones made for constant arguments
+    int specializeGrowth = 50;     // -specialize-growth=N: percent the program may grow by cloning
+    bool memoize = false;          // -memoize: cache the results of recursive functions that write nothing
+};
+
+} // namespace codegen
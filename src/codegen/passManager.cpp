@@ -0,0 +1,159 @@
+#include "passManager.hpp"
+#include "visitorAnalyzer.hpp"
+#include "../ir/visitorIrBuilder.hpp"
+#include "../ir/mem2reg.hpp"
+#include "../ir/verifier.hpp"
+#include "../opt/constantFolding.hpp"
+#include "../opt/constantReturns.hpp"
+#include "../opt/inliner.hpp"
+#include "../opt/sccp.hpp"
+#include "../opt/specialization.hpp"
+#include "../opt/tailRecursion.hpp"
+#include "../opt/deadCodeElimination.hpp"
+#include "../opt/deadFunctionElimination.hpp"
+#include "../opt/deadStoreElimination.hpp"
+#include "../opt/valueNumbering.hpp"
+
+namespace codegen {
+
+AnalysisCache::AnalysisCache(NodeProgram& program, Statistics& statistics)
+    : program(program), statistics(statistics) {}
+
+ScopeNode* AnalysisCache::getScopes() {
+    if (!scopes) {
+        ScopedTimer timer(statistics, "analysis-scopes");
+        VisitorAnalyzer analyzer;
+        analyzer.analyze(program);
+        scopes = analyzer.releaseRootScope();
+        statistics.add("analyses", "scopes-computed", 1);
+    }
+    return scopes.get();
+}
+
+const CallGraph& AnalysisCache::getCallGraph() {
+    if (!callGraph.has_value()) {
+        ScopedTimer timer(statistics, "analysis-call-graph");
+        VisitorCallGraph builder;
+        callGraph = builder.analyze(program);
+        statistics.add("analyses", "call-graph-computed", 1);
+    }
+    return callGraph.value();
+}
+
+std::unordered_map<std::string, FunctionLiveness>& AnalysisCache::getLiveness() {
+    if (!liveness.has_value()) {
+        ScopeNode* root = getScopes();
+        ScopedTimer timer(statistics, "analysis-liveness");
+        VisitorLiveness visitor(root);
+        liveness = visitor.analyze(program);
+        statistics.add("analyses", "liveness-computed", 1);
+    }
+    return liveness.value();
+}
+
+ir::Module& AnalysisCache::getIr() {
+    if (!module.has_value()) {
+        computeIr();
+    }
+    return module.value();
+}
+
+void AnalysisCache::invalidate(Analysis analysis) {
+    switch (analysis) {
+        case Analysis::Scopes:
+            scopes.reset();
+            liveness.reset();
+            module.reset();
+            break;
+        case Analysis::CallGraph:
+            callGraph.reset();
+            break;
+        case Analysis::Liveness:
+            liveness.reset();
+            break;
+        case Analysis::Ir:
+            module.reset();
+            break;
+        default:
+            throw std::runtime_error("[AnalysisCache::invalidate] Unknown analysis");
+    }
+}
+
+void AnalysisCache::invalidateAllBut(const std::set<Analysis>& preserved) {
+    for (Analysis analysis : {Analysis::Scopes, Analysis::CallGraph, Analysis::Liveness, Analysis::Ir}) {
+        if (!preserved.count(analysis)) {
+            invalidate(analysis);
+        }
+    }
+}
+
+void AnalysisCache::computeIr() {
+    ScopeNode* root = getScopes();
+    ScopedTimer timer(statistics, "analysis-ir");
+
+    VisitorIrBuilder builder(root);
+    ir::Module built = builder.build(program);
+    ir::Verifier::verify(built);
+
+    ir::Mem2Reg mem2reg;
+    int blocks = 0;
+    for (auto& function : built.functions) {
+        mem2reg.run(function);
+        blocks += static_cast<int>(function.blocks.size());
+    }
+    ir::Verifier::verify(built);
+    module = std::move(built);
+
+    statistics.add("analyses", "ir-computed", 1);
+    statistics.add("ir", "blocks", blocks);
+    statistics.add("ir", "unreachable-blocks-removed", builder.getUnreachableBlocksRemoved());
+    statistics.add("ir", "loads-promoted", mem2reg.getLoadsPromoted());
+    statistics.add("ir", "phis-inserted", mem2reg.getPhisInserted());
+    statistics.add("ir", "dead-phis-removed", mem2reg.getPhisRemoved());
+}
+
+PassManager::PassManager(const Options& options) : level(options.optimizationLevel) {
+    add(1, std::make_unique<opt::DeadFunctionElimination>());  // Before anything analyzes them
+    add(1, std::make_unique<opt::ConstantFolding>());
+    add(1, std::make_unique<opt::TailRecursion>());
+    add(2, std::make_unique<opt::Inliner>(options));
+    add(2, std::make_unique<opt::Sccp>());             // Arguments of inlined calls become constants
+    add(2, std::make_unique<opt::ConstantFolding>());
+    add(2, std::make_unique<opt::Specialization>(options));
+    add(2, std::make_unique<opt::ConstantReturnPropagation>());
+    add(2, std::make_unique<opt::Sccp>());
+    add(2, std::make_unique<opt::ConstantFolding>());  // Folds around the constants SCCP substituted
+    add(1, std::make_unique<opt::DeadCodeElimination>());
+    add(1, std::make_unique<opt::ValueNumbering>(level >= 2));
+    add(2, std::make_unique<opt::DeadStoreElimination>());
+    add(1, std::make_unique<opt::DeadFunctionElimination>());  // Callers all inlined or cloned
+}
+
+void PassManager::add(int minimumLevel, std::unique_ptr<Pass> pass) {
+    if (level >= minimumLevel) {
+        passes.push_back(std::move(pass));
+    }
+}
+
+void PassManager::run(NodeProgram& program, AnalysisCache& analyses, Statistics& statistics) {
+    for (const auto& pass : passes) {
+        bool changed;
+        {
+            ScopedTimer timer(statistics, std::string("pass-") + pass->name());
+            changed = pass->run(program, analyses, statistics);
+        }
+        if (changed) {
+            analyses.invalidateAllBut(pass->preserved());
+        }
+    }
+}
+
+ScopedTimer::ScopedTimer(Statistics& statistics, std::string counter)
+    : statistics(statistics), counter(std::move(counter)), start(std::chrono::steady_clock::now()) {}
+
+ScopedTimer::~ScopedTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    statistics.add("time-us", counter, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+} // namespace codegen
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <set>
+#include "options.hpp"
+#include "statistics.hpp"
+#include "scopeNode.hpp"
+#include "visitorLiveness.hpp"
+#include "visitorCallGraph.hpp"
+#include "../ir/ir.hpp"
+
+namespace codegen {
+
+enum class Analysis { Scopes, CallGraph, Liveness, Ir };
+
+/* Results computed from the AST, kept until a pass changes the program. Liveness and the IR
+   point into the scope tree, so dropping the scopes drops them as well. Every computation is
+   timed and counted in the statistics. */
+class AnalysisCache {
+public:
+    AnalysisCache(NodeProgram& program, Statistics& statistics);
+
+    ScopeNode* getScopes();
+    const CallGraph& getCallGraph();
+    std::unordered_map<std::string, FunctionLiveness>& getLiveness();
+    ir::Module& getIr();  // In SSA form and verified
+
+    void invalidate(Analysis analysis);
+    void invalidateAllBut(const std::set<Analysis>& preserved);
+
+private:
+    NodeProgram& program;
+    Statistics& statistics;
+
+    std::unique_ptr<ScopeNode> scopes;
+    std::optional<CallGraph> callGraph;
+    std::optional<std::unordered_map<std::string, FunctionLiveness>> liveness;
+    std::optional<ir::Module> module;
+
+    void computeIr();
+};
+
+// A transformation of the whole program
+class Pass {
+public:
+    virtual ~Pass() = default;
+
+    virtual const char* name() const = 0;
+
+    // Returns whether the program changed; analyses not listed by preserved() are then dropped
+    virtual bool run(NodeProgram& program, AnalysisCache& analyses, Statistics& statistics) = 0;
+    virtual std::set<Analysis> preserved() const { return {}; }
+};
+
+/* Runs the pipeline chosen by the optimization level in order, timing every pass.
+   -O0 runs nothing, -O1 the cheap local passes and -O2 everything. */
+class PassManager {
+public:
+    explicit PassManager(const Options& options);
+
+    // Appends the pass when the optimization level is at least minimumLevel
+    void add(int minimumLevel, std::unique_ptr<Pass> pass);
+    void run(NodeProgram& program, AnalysisCache& analyses, Statistics& statistics);
+
+private:
+    int level;
+    std::vector<std::unique_ptr<Pass>> passes;
+};
+
+// Records the wall time of a scope in microseconds under the "time-us" statistics
+class ScopedTimer {
+public:
+    ScopedTimer(Statistics& statistics, std::string counter);
+    ~ScopedTimer();
+
+private:
+    Statistics& statistics;
+    std::string counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace codegen
@@ -0,0 +1,308 @@
+#include "peephole.hpp"
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace peephole {
+
+static_assert([] {
+    for (const Pattern& pattern : patterns) {
+        if (!wellFormed(pattern)) {
+            return false;
+        }
+    }
+    return true;
+}(), "Every hole of a rewrite or guard must be bound by the match");
+
+namespace {
+
+struct Instruction {
+    std::string mnemonic;  // Label name for labels
+    std::vector<std::string> operands;
+    bool isLabel = false;
+};
+
+Instruction parse(std::string_view line) {
+    Instruction instruction;
+    if (!line.empty() && line.back() == ':') {
+        instruction.mnemonic = std::string(line.substr(0, line.size() - 1));
+        instruction.isLabel = true;
+        return instruction;
+    }
+
+    size_t space = line.find(' ');
+    instruction.mnemonic = std::string(line.substr(0, space));
+    if (space == std::string_view::npos) {
+        return instruction;
+    }
+    std::string_view rest = line.substr(space + 1);
+    for (size_t comma; (comma = rest.find(", ")) != std::string_view::npos;) {
+        instruction.operands.emplace_back(rest.substr(0, comma));
+        rest = rest.substr(comma + 2);
+    }
+    instruction.operands.emplace_back(rest);
+    return instruction;
+}
+
+// Holes are named by a single letter
+using Bindings = std::array<std::optional<std::string>, 26>;
+
+std::optional<int> holeIndex(std::string_view text) {
+    if (text.size() == 3 && text[0] == '{' && text[2] == '}' && text[1] >= 'a' && text[1] <= 'z') {
+        return text[1] - 'a';
+    }
+    return std::nullopt;
+}
+
+bool bind(std::string_view pattern, const std::string& text, Bindings& bindings) {
+    auto hole = holeIndex(pattern);
+    if (!hole.has_value()) {
+        return pattern == text;
+    }
+    auto& slot = bindings[hole.value()];
+    if (slot.has_value()) {
+        return slot.value() == text;
+    }
+    slot = text;
+    return true;
+}
+
+bool matchLine(std::string_view pattern, const std::string& line, Bindings& bindings) {
+    Instruction expected = parse(pattern);
+    Instruction actual = parse(line);
+    if (expected.isLabel != actual.isLabel || expected.operands.size() != actual.operands.size()) {
+        return false;
+    }
+    if (!bind(expected.mnemonic, actual.mnemonic, bindings)) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.operands.size(); i++) {
+        if (!bind(expected.operands[i], actual.operands[i], bindings)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string expand(std::string_view pattern, const Bindings& bindings) {
+    std::string result;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        auto hole = i + 2 < pattern.size() ? holeIndex(pattern.substr(i, 3)) : std::nullopt;
+        if (hole.has_value()) {
+            result += bindings[hole.value()].value();
+            i += 2;
+        } else {
+            result += pattern[i];
+        }
+    }
+    return result;
+}
+
+// 64-bit register behind any of its names, or "" when the text is not a register
+std::string fullRegister(std::string_view name) {
+    static const std::unordered_map<std::string_view, std::string_view> aliases = {
+        {"rax", "rax"}, {"eax", "rax"}, {"ax", "rax"}, {"al", "rax"},
+        {"rbx", "rbx"}, {"ebx", "rbx"}, {"bx", "rbx"}, {"bl", "rbx"},
+        {"rcx", "rcx"}, {"ecx", "rcx"}, {"cx", "rcx"}, {"cl", "rcx"},
+        {"rdx", "rdx"}, {"edx", "rdx"}, {"dx", "rdx"}, {"dl", "rdx"},
+        {"rsi", "rsi"}, {"esi", "rsi"}, {"rdi", "rdi"}, {"edi", "rdi"},
+        {"rbp", "rbp"}, {"rsp", "rsp"},
+        {"r8", "r8"}, {"r8d", "r8"}, {"r9", "r9"}, {"r9d", "r9"},
+        {"r10", "r10"}, {"r10d", "r10"}, {"r11", "r11"}, {"r11d", "r11"},
+        {"r12", "r12"}, {"r12d", "r12"}, {"r13", "r13"}, {"r13d", "r13"},
+        {"r14", "r14"}, {"r14d", "r14"}, {"r15", "r15"}, {"r15d", "r15"},
+    };
+    auto it = aliases.find(name);
+    return it != aliases.end() ? std::string(it->second) : "";
+}
+
+bool isMemory(std::string_view operand) {
+    return operand.find('[') != std::string_view::npos;
+}
+
+// Registers an operand reads when it is only a source: itself, or the address registers
+std::vector<std::string> operandReads(std::string_view operand) {
+    if (!isMemory(operand)) {
+        std::string reg = fullRegister(operand);
+        return reg.empty() ? std::vector<std::string>{} : std::vector<std::string>{reg};
+    }
+
+    std::vector<std::string> reads;
+    std::string word;
+    for (char c : operand.substr(operand.find('['))) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            word += c;
+            continue;
+        }
+        if (std::string reg = fullRegister(word); !reg.empty()) {
+            reads.push_back(reg);
+        }
+        word.clear();
+    }
+    return reads;
+}
+
+struct Effects {
+    std::vector<std::string> reads;
+    std::vector<std::string> writes;  // Registers fully overwritten
+    bool opaque = false;              // Control flow or an unknown instruction
+};
+
+Effects effects(const Instruction& instruction) {
+    Effects result;
+    const std::string& op = instruction.mnemonic;
+    const auto& operands = instruction.operands;
+
+    auto readAll = [&](size_t from) {
+        for (size_t i = from; i < operands.size(); i++) {
+            auto reads = operandReads(operands[i]);
+            result.reads.insert(result.reads.end(), reads.begin(), reads.end());
+        }
+    };
+    auto writeDestination = [&]() {
+        if (isMemory(operands[0])) {
+            readAll(0);
+        } else if (std::string reg = fullRegister(operands[0]); !reg.empty()) {
+            result.writes.push_back(reg);
+        }
+    };
+
+    bool writeOnly = op == "mov" || op == "lea" || op == "movzx" || op == "pop" || (op == "imul" && operands.size() == 3);
+    bool readWrite = op == "add" || op == "sub" || op == "imul" || op == "and" || op == "or" || op == "xor" ||
+                     op == "inc" || op == "dec" || op == "neg" || op == "shl" || op == "sar" || op == "shr" ||
+                     op.starts_with("cmov") || op.starts_with("set");
+    bool readOnly = op == "cmp" || op == "test" || op == "push";
+
+    if (op == "xor" && operands.size() == 2 && operands[0] == operands[1]) {
+        writeDestination();  // Zeroing idiom, the old value is not read
+    } else if (writeOnly && !operands.empty()) {
+        readAll(1);
+        writeDestination();
+    } else if (readWrite && !operands.empty()) {
+        readAll(0);
+    } else if (readOnly) {
+        readAll(0);
+    } else if (op == "cqo") {
+        result.reads.push_back("rax");
+        result.writes.push_back("rdx");
+    } else if (op == "idiv") {
+        readAll(0);
+        result.reads.insert(result.reads.end(), {"rax", "rdx"});
+        result.writes.insert(result.writes.end(), {"rax", "rdx"});
+    } else {
+        result.opaque = true;
+    }
+    return result;
+}
+
+// Whether the register's value is dead before line 'from': scans the fall-through path
+bool isDead(const std::vector<std::string>& lines, size_t from, const std::string& reg) {
+    static const std::vector<std::string> argumentRegisters = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+    static const std::vector<std::string> liveOnReturn = {"rax", "rbx", "rbp", "rsp", "r12", "r13", "r14", "r15"};
+
+    for (size_t i = from; i < lines.size(); i++) {
+        Instruction instruction = parse(lines[i]);
+        if (instruction.isLabel) {
+            continue;  // Other predecessors do not change what this path needs
+        }
+        if (instruction.mnemonic == "ret") {
+            return std::find(liveOnReturn.begin(), liveOnReturn.end(), reg) == liveOnReturn.end();
+        }
+        if (instruction.mnemonic == "call") {
+            // Reads the arguments; other registers may survive the callee, so keep scanning
+            if (std::find(argumentRegisters.begin(), argumentRegisters.end(), reg) != argumentRegisters.end()) {
+                return false;
+            }
+            if (reg == "rax") {
+                return true;
+            }
+            continue;
+        }
+
+        Effects effect = effects(instruction);
+        if (effect.opaque || std::find(effect.reads.begin(), effect.reads.end(), reg) != effect.reads.end()) {
+            return false;
+        }
+        if (std::find(effect.writes.begin(), effect.writes.end(), reg) != effect.writes.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool holds(const Check& check, const Bindings& bindings, const std::vector<std::string>& lines, size_t after) {
+    if (check.guard == Guard::None) {
+        return true;
+    }
+    std::string first = expand(check.first, bindings);
+    std::string second = expand(check.second, bindings);
+    switch (check.guard) {
+        case Guard::Dead: {
+            std::string reg = fullRegister(first);
+            return !reg.empty() && isDead(lines, after, reg);
+        }
+        case Guard::IsRegister:    return !fullRegister(first).empty();
+        case Guard::IsMemory:      return isMemory(first);
+        case Guard::NotBothMemory: return !isMemory(first) || !isMemory(second);
+        case Guard::DoesNotRead: {
+            auto reads = operandReads(first);
+            return std::find(reads.begin(), reads.end(), fullRegister(second)) == reads.end();
+        }
+        default:
+            throw std::runtime_error("[peephole::holds] Unknown guard");
+    }
+}
+
+} // namespace
+
+Optimizer::Optimizer() : counts{} {}
+
+std::vector<std::string> Optimizer::run(std::vector<std::string> lines) {
+    std::erase_if(lines, [](const std::string& line) { return line.empty(); });
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 0; i < lines.size(); i++) {
+            for (size_t p = 0; p < patterns.size(); p++) {
+                const Pattern& pattern = patterns[p];
+                size_t length = std::count_if(pattern.match.begin(), pattern.match.end(), [](auto line) { return !line.empty(); });
+                if (i + length > lines.size()) {
+                    continue;
+                }
+
+                Bindings bindings;
+                bool matched = true;
+                for (size_t k = 0; k < length && matched; k++) {
+                    matched = matchLine(pattern.match[k], lines[i + k], bindings);
+                }
+                matched = matched && std::all_of(pattern.checks.begin(), pattern.checks.end(), [&](const Check& check) {
+                    return holds(check, bindings, lines, i + length);
+                });
+                if (!matched) {
+                    continue;
+                }
+
+                std::vector<std::string> rewrite;
+                for (std::string_view line : pattern.rewrite) {
+                    if (!line.empty()) {
+                        rewrite.push_back(expand(line, bindings));
+                    }
+                }
+                lines.erase(lines.begin() + i, lines.begin() + i + length);
+                lines.insert(lines.begin() + i, rewrite.begin(), rewrite.end());
+
+                counts[p]++;
+                changed = true;
+                break;
+            }
+        }
+    }
+    return lines;
+}
+
+const std::array<int, patternCount>& Optimizer::getCounts() const {
+    return counts;
+}
+
+} // namespace peephole
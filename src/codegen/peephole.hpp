@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Peephole optimization over the emitted instructions of one function. Patterns are windows of
+// up to three consecutive lines with holes ({a}, {b}, ...) standing for whole operands; a match
+// whose guards hold is replaced by the rewrite, and the scan repeats until nothing fires.
+namespace peephole {
+
+enum class Guard {
+    None,
+    Dead,            // The register {0} is overwritten before it is read again
+    IsRegister,      // {0} is a register
+    IsMemory,        // {0} is a memory operand
+    NotBothMemory,   // {0} and {1} are not both memory operands
+    DoesNotRead,     // The operand {0} does not read the register {1}
+};
+
+struct Check {
+    Guard guard = Guard::None;
+    std::string_view first = "";
+    std::string_view second = "";
+};
+
+struct Pattern {
+    std::string_view name;
+    std::array<std::string_view, 3> match;    // Unused trailing lines are empty
+    std::array<std::string_view, 2> rewrite;  // Unused trailing lines are empty
+    std::array<Check, 2> checks;
+};
+
+inline constexpr std::array patterns = {
+    Pattern{"push-pop-same",        {"push {a}", "pop {a}"},              {},                              {}},
+    Pattern{"push-pop-to-move",     {"push {a}", "pop {b}"},              {"mov {b}, {a}"},                {Check{Guard::NotBothMemory, "{a}", "{b}"}}},
+    Pattern{"self-move",            {"mov {a}, {a}"},                     {},                              {}},
+    Pattern{"store-reload",         {"mov {m}, {r}", "mov {r}, {m}"},     {"mov {m}, {r}"},                {Check{Guard::IsMemory, "{m}"}, Check{Guard::IsRegister, "{r}"}}},
+    Pattern{"store-load-forward",   {"mov {m}, {r}", "mov {s}, {m}"},     {"mov {m}, {r}", "mov {s}, {r}"}, {Check{Guard::IsMemory, "{m}"}, Check{Guard::IsRegister, "{r}"}}},
+    Pattern{"jump-to-next",         {"jmp {l}", "{l}:"},                  {"{l}:"},                        {}},
+    Pattern{"load-via-scratch",     {"mov rax, {x}", "mov {r}, rax"},     {"mov {r}, {x}"},                {Check{Guard::Dead, "rax"}, Check{Guard::NotBothMemory, "{r}", "{x}"}}},
+    Pattern{"lea-via-scratch",      {"lea rax, {x}", "mov {r}, rax"},     {"lea {r}, {x}"},                {Check{Guard::Dead, "rax"}, Check{Guard::IsRegister, "{r}"}}},
+    Pattern{"imul-via-scratch",     {"imul rax, {a}, {i}", "mov {r}, rax"}, {"imul {r}, {a}, {i}"},        {Check{Guard::Dead, "rax"}, Check{Guard::IsRegister, "{r}"}}},
+    Pattern{"copy-via-temporary",   {"mov {t}, {a}", "mov {r}, {t}"},     {"mov {r}, {a}"},                {Check{Guard::Dead, "{t}"}, Check{Guard::NotBothMemory, "{r}", "{a}"}}},
+    Pattern{"overwritten-move",     {"mov {r}, {x}", "mov {r}, {y}"},     {"mov {r}, {y}"},                {Check{Guard::IsRegister, "{r}"}, Check{Guard::DoesNotRead, "{y}", "{r}"}}},
+};
+
+inline constexpr size_t patternCount = patterns.size();
+
+// A pattern is well formed when every hole of its rewrite and checks is bound by its match
+// Text is taken by reference: GCC 12 rejects copying the value-initialized table entries here
+constexpr bool bindsHoles(const Pattern& pattern, const std::string_view& text) {
+    for (size_t i = 0; i + 2 < text.size(); i++) {
+        if (text[i] != '{' || text[i + 2] != '}') {
+            continue;
+        }
+        std::string_view hole = text.substr(i, 3);
+        bool bound = false;
+        for (const std::string_view& line : pattern.match) {
+            bound = bound || line.find(hole) != std::string_view::npos;
+        }
+        if (!bound) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool wellFormed(const Pattern& pattern) {
+    for (const std::string_view& line : pattern.rewrite) {
+        if (!bindsHoles(pattern, line)) {
+            return false;
+        }
+    }
+    for (const Check& check : pattern.checks) {
+        if (!bindsHoles(pattern, check.first) || !bindsHoles(pattern, check.second)) {
+            return false;
+        }
+    }
+    return !pattern.match[0].empty();
+}
+
+class Optimizer {
+public:
+    Optimizer();
+
+    /* Rewrites the function until no pattern matches, blank lines are dropped */
+    std::vector<std::string> run(std::vector<std::string> lines);
+
+    /* How often each entry of the pattern table fired over every run */
+    const std::array<int, patternCount>& getCounts() const;
+
+private:
+    std::array<int, patternCount> counts;
+};
+
+} // namespace peephole
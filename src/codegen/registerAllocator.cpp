@@ -0,0 +1,196 @@
+#include "registerAllocator.hpp"
+#include <algorithm>
+
+const std::vector<std::string>& RegisterAllocator::getCallerSavedRegisters() {
+    // rax, rcx and rdx are reserved as scratch registers by the generator
+    static const std::vector<std::string> callerSaved = {"rsi", "rdi", "r8", "r9"};
+    return callerSaved;
+}
+
+const std::vector<std::string>& RegisterAllocator::getCalleeSavedRegisters() {
+    static const std::vector<std::string> calleeSaved = {"rbx", "r12", "r13", "r14", "r15"};
+    return calleeSaved;
+}
+
+const std::vector<std::string>& RegisterAllocator::getTemporaryRegisters() {
+    // Never given to locals, so expression temporaries always have somewhere to go
+    static const std::vector<std::string> temporaries = {"r11", "r10"};
+    return temporaries;
+}
+
+const std::vector<std::string>& RegisterAllocator::getArgumentRegisters() {
+    static const std::vector<std::string> argRegs = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+    return argRegs;
+}
+
+const RegisterSet& RegisterAllocator::getAbiClobbers() {
+    static const RegisterSet clobbers = {"rax", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11"};
+    return clobbers;
+}
+
+bool RegisterAllocator::isCalleeSaved(const std::string& reg) {
+    const auto& calleeSaved = getCalleeSavedRegisters();
+    return std::find(calleeSaved.begin(), calleeSaved.end(), reg) != calleeSaved.end();
+}
+
+RegisterSet RegisterAllocator::callClobbers(const NodeExpressionFunctionCall& call,
+                                            const std::unordered_map<std::string, RegisterSet>& calleeClobbers) {
+    auto it = calleeClobbers.find(call.functionName);
+    RegisterSet clobbers = it != calleeClobbers.end() ? it->second : getAbiClobbers();
+
+    // The caller itself overwrites the argument registers and receives the result in rax
+    clobbers.insert("rax");
+    const auto& argRegs = getArgumentRegisters();
+    for (size_t i = 0; i < call.arguments.size() && i < argRegs.size(); i++) {
+        clobbers.insert(argRegs[i]);
+    }
+    return clobbers;
+}
+
+FunctionAllocation RegisterAllocator::allocate(FunctionLiveness& liveness,
+                                               const std::unordered_map<std::string, RegisterSet>& calleeClobbers) const {
+    FunctionAllocation allocation;
+    for (const auto& [call, callPosition] : liveness.callPositions) {
+        allocation.callClobbers[call] = callClobbers(*call, calleeClobbers);
+    }
+
+    auto crosses = [&liveness](const LiveInterval& interval, const NodeExpressionFunctionCall* call, int callPosition) {
+        const auto& around = liveness.readsAroundCall[call];
+        bool readAfterCall = std::find(around.begin(), around.end(), interval.variable) != around.end();
+        return readAfterCall || (interval.start < callPosition && callPosition < interval.end);
+    };
+
+    std::vector<LiveInterval*> unhandled;
+    for (auto& interval : liveness.intervals) {
+        interval.variable->reg.clear();
+        unhandled.push_back(&interval);
+    }
+    std::stable_sort(unhandled.begin(), unhandled.end(), [](const LiveInterval* a, const LiveInterval* b) {
+        return a->start < b->start;
+    });
+
+    // The free list is kept in preference order so allocation is deterministic:
+    // caller-saved registers first, they never cost a save in the prologue
+    std::vector<std::string> order = getCallerSavedRegisters();
+    order.insert(order.end(), getCalleeSavedRegisters().begin(), getCalleeSavedRegisters().end());
+    std::vector<std::string> freeRegisters = order;
+    std::vector<LiveInterval*> active;
+
+    auto release = [&](const std::string& reg) {
+        freeRegisters.push_back(reg);
+        std::sort(freeRegisters.begin(), freeRegisters.end(), [&order](const std::string& a, const std::string& b) {
+            return std::find(order.begin(), order.end(), a) < std::find(order.begin(), order.end(), b);
+        });
+    };
+
+    auto take = [&](LiveInterval* interval, std::vector<std::string>::iterator reg) {
+        interval->variable->reg = *reg;
+        freeRegisters.erase(reg);
+        active.push_back(interval);
+    };
+
+    for (LiveInterval* interval : unhandled) {
+        // Expire intervals that ended before this one starts
+        for (auto it = active.begin(); it != active.end();) {
+            if ((*it)->end < interval->start) {
+                release((*it)->variable->reg);
+                it = active.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Registers overwritten by any call the value has to survive
+        RegisterSet blocked;
+        for (const auto& [call, callPosition] : liveness.callPositions) {
+            if (crosses(*interval, call, callPosition)) {
+                const auto& clobbers = allocation.callClobbers[call];
+                blocked.insert(clobbers.begin(), clobbers.end());
+            }
+        }
+        auto isFree = [&blocked](const std::string& reg) { return !blocked.count(reg); };
+
+        // A parameter left in the register it arrives in needs no move on entry
+        auto parameter = std::find(liveness.parameters.begin(), liveness.parameters.end(), interval->variable);
+        if (parameter != liveness.parameters.end()) {
+            const std::string& arrival = getArgumentRegisters()[parameter - liveness.parameters.begin()];
+            auto reg = std::find(freeRegisters.begin(), freeRegisters.end(), arrival);
+            if (reg != freeRegisters.end() && isFree(arrival)) {
+                take(interval, reg);
+                continue;
+            }
+        }
+
+        // Any register no crossed call touches survives for free
+        auto reg = std::find_if(freeRegisters.begin(), freeRegisters.end(), isFree);
+        if (reg != freeRegisters.end()) {
+            take(interval, reg);
+            continue;
+        }
+
+        // Otherwise the value is saved around every call that clobbers it
+        if (!freeRegisters.empty()) {
+            take(interval, freeRegisters.begin());
+            continue;
+        }
+
+        // Register pressure: spill whichever live range is cheapest to keep in memory
+        auto cheapest = std::min_element(active.begin(), active.end(), [](const LiveInterval* a, const LiveInterval* b) {
+            return a->weight < b->weight;
+        });
+        if ((*cheapest)->weight < interval->weight) {
+            interval->variable->reg = (*cheapest)->variable->reg;
+            (*cheapest)->variable->reg.clear();
+            *cheapest = interval;
+        }
+    }
+
+    liveness.scope->layoutStackSlots();
+
+    // A parameter touched only by its definition on entry needs no move there
+    for (const VarInfo* parameter : liveness.parameters) {
+        auto interval = std::find_if(liveness.intervals.begin(), liveness.intervals.end(),
+                                     [parameter](const LiveInterval& candidate) { return candidate.variable == parameter; });
+        allocation.parametersUsed.push_back(interval != liveness.intervals.end() && interval->end > interval->start);
+    }
+
+    for (const auto& interval : liveness.intervals) {
+        if (!interval.variable->reg.empty()) {
+            allocation.localRegisters.insert(interval.variable->reg);
+        }
+    }
+
+    for (const auto& reg : getCalleeSavedRegisters()) {
+        if (allocation.localRegisters.count(reg)) {
+            allocation.calleeSavedUsed.push_back(reg);
+        }
+    }
+
+    // Caller-saved registers left unused by locals join the expression temporary pool,
+    // last argument register first so temporaries rarely collide with outgoing arguments
+    allocation.temporaryRegisters = getTemporaryRegisters();
+    const auto& callerSaved = getCallerSavedRegisters();
+    for (auto it = callerSaved.rbegin(); it != callerSaved.rend(); ++it) {
+        bool used = std::any_of(liveness.intervals.begin(), liveness.intervals.end(), [&it](const LiveInterval& interval) {
+            return interval.variable->reg == *it;
+        });
+        if (!used) {
+            allocation.temporaryRegisters.push_back(*it);
+        }
+    }
+
+    // Registers holding a value that is still needed after a call get saved around it
+    // when the call may overwrite them
+    for (const auto& [call, callPosition] : liveness.callPositions) {
+        auto& saved = allocation.savedAroundCall[call];
+        const auto& clobbers = allocation.callClobbers[call];
+        for (const auto& interval : liveness.intervals) {
+            const std::string& reg = interval.variable->reg;
+            if (!reg.empty() && clobbers.count(reg) && crosses(interval, call, callPosition)) {
+                saved.push_back(reg);
+            }
+        }
+    }
+
+    return allocation;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "visitorLiveness.hpp"
+
+using RegisterSet = std::set<std::string>;
+
+struct FunctionAllocation {
+    RegisterSet localRegisters;                // Every register given to a local
+    std::vector<std::string> calleeSavedUsed;  // Saved in the prologue, restored before every ret
+    std::unordered_map<const NodeExpressionFunctionCall*, std::vector<std::string>> savedAroundCall;
+    std::unordered_map<const NodeExpressionFunctionCall*, RegisterSet> callClobbers;  // Registers each call may overwrite
+    std::vector<std::string> temporaryRegisters;  // Caller-saved registers no local was given
+    std::vector<bool> parametersUsed;             // False for a parameter nothing touches after entry
+};
+
+/* Linear-scan register allocator over the intervals computed by VisitorLiveness.
+   Functions are allocated callees first: the registers a callee really clobbers are known, so
+   values crossing a call can sit in any caller-saved register the callee leaves alone. Every
+   function still restores the callee-saved registers it uses. */
+class RegisterAllocator {
+public:
+    static const std::vector<std::string>& getCallerSavedRegisters();
+    static const std::vector<std::string>& getCalleeSavedRegisters();
+    static const std::vector<std::string>& getTemporaryRegisters();
+    static const std::vector<std::string>& getArgumentRegisters();
+    static const RegisterSet& getAbiClobbers();
+    static bool isCalleeSaved(const std::string& reg);
+
+    // calleeClobbers holds the final clobber set of every function generated so far,
+    // calls to any other function are assumed to follow the System V ABI
+    FunctionAllocation allocate(FunctionLiveness& liveness,
+                                const std::unordered_map<std::string, RegisterSet>& calleeClobbers) const;
+
+private:
+    static RegisterSet callClobbers(const NodeExpressionFunctionCall& call,
+                                    const std::unordered_map<std::string, RegisterSet>& calleeClobbers);
+};
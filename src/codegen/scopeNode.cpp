@@ -24,7 +24,7 @@ void ScopeNode::addVariable(const std::string& name, Type type, int size) {
         throw std::runtime_error("[ScopeNode::addVariable] Variable " + name + " already exists in this scope");
     }
     currentOffset += size;  // Increment before storing
-    variables.push_back({name, type, currentOffset, size});
+    variables.push_back({name, type, currentOffset, size, ""});
 }
 
 std::optional<int> ScopeNode::getOffset(const std::string& name) const {
@@ -65,6 +65,57 @@ std::optional<Type> ScopeNode::getTypeRecursive(const std::string& name) const {
     return std::nullopt;
 }
 
+VarInfo* ScopeNode::findVariable(const std::string& name) {
+    for (auto& var : variables) {
+        if (var.name == name) {
+            return &var;
+        }
+    }
+    return nullptr;
+}
+
+VarInfo* ScopeNode::findVariableRecursive(const std::string& name) {
+    if (auto var = findVariable(name)) {
+        return var;
+    }
+    if (parent) {
+        return parent->findVariableRecursive(name);
+    }
+    return nullptr;
+}
+
+std::optional<std::string> ScopeNode::getLocationRecursive(const std::string& name, const std::string& base) const {
+    for (const auto& var : variables) {
+        if (var.name == name) {
+            if (!var.reg.empty()) {
+                return var.reg;
+            }
+            return "[" + base + " - " + std::to_string(var.offset) + "]";
+        }
+    }
+    if (parent) {
+        return parent->getLocationRecursive(name, base);
+    }
+    return std::nullopt;
+}
+
+void ScopeNode::layoutStackSlots() {
+    layoutStackSlots(parent ? parent->currentOffset : 0);
+}
+
+void ScopeNode::layoutStackSlots(int baseOffset) {
+    currentOffset = baseOffset;
+    for (auto& var : variables) {
+        if (var.reg.empty()) {
+            currentOffset += var.size;
+            var.offset = currentOffset;
+        }
+    }
+    for (auto& child : children) {
+        child->layoutStackSlots(currentOffset);
+    }
+}
+
 int ScopeNode::getFrameSize() const {
     int maxOffset = currentOffset;  // locals in this scope
     for (const auto& child : children) {
@@ -94,7 +145,11 @@ void ScopeNode::dump(int depth) const {
         std::cout << indent << "  - " << var.name
                   << " : type=" << static_cast<int>(var.type)
                   << ", offset=" << var.offset
-                  << ", size=" << var.size << '\n';
+                  << ", size=" << var.size;
+        if (!var.reg.empty()) {
+            std::cout << ", reg=" << var.reg;
+        }
+        std::cout << '\n';
     }
 
     for (const auto& child : children) {
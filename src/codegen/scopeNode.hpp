@@ -14,6 +14,7 @@ struct VarInfo {
     Type type;
     int offset;
     int size;
+    std::string reg; // Register assigned by the allocator, empty when the variable lives on the stack
 };
 
 class ScopeNode {
@@ -31,6 +32,15 @@ public:
     std::optional<int> getOffsetRecursive(const std::string& name) const;
     std::optional<Type> getTypeRecursive(const std::string& name) const;
 
+    VarInfo* findVariable(const std::string& name);
+    VarInfo* findVariableRecursive(const std::string& name);
+
+    /* Operand string for a variable: its register, or its [base - N] stack slot */
+    std::optional<std::string> getLocationRecursive(const std::string& name, const std::string& base = "rbp") const;
+
+    /* Reassign stack offsets so only variables without a register take frame space */
+    void layoutStackSlots();
+
     int getFrameSize() const;
     bool hasChildren() const;
     ScopeNode& getChild(int index);
@@ -43,4 +53,6 @@ private:
     std::vector<VarInfo> variables;
 
     int currentOffset = 0;
+
+    void layoutStackSlots(int baseOffset);
 };
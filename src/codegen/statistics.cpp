@@ -0,0 +1,51 @@
+#include "statistics.hpp"
+#include <algorithm>
+#include <iomanip>
+
+namespace codegen {
+
+void Statistics::add(const std::string& pass, const std::string& counter, long value) {
+    auto it = std::find_if(passes.begin(), passes.end(), [&](const auto& entry) { return entry.first == pass; });
+    if (it == passes.end()) {
+        it = passes.insert(passes.end(), {pass, {}});
+    }
+
+    auto& counters = it->second;
+    auto counterIt = std::find_if(counters.begin(), counters.end(), [&](const auto& entry) { return entry.first == counter; });
+    if (counterIt == counters.end()) {
+        counters.emplace_back(counter, value);
+    } else {
+        counterIt->second += value;
+    }
+}
+
+void Statistics::print(std::ostream& out) const {
+    // Values line up in one column that leaves at least two spaces after the longest counter
+    size_t width = 28;
+    for (const auto& [pass, counters] : passes) {
+        for (const auto& [counter, value] : counters) {
+            width = std::max(width, counter.size() + 2);
+        }
+    }
+
+    for (const auto& [pass, counters] : passes) {
+        out << pass << ":" << std::endl;
+        for (const auto& [counter, value] : counters) {
+            out << "  " << std::left << std::setw(static_cast<int>(width)) << counter << value << std::endl;
+        }
+    }
+}
+
+void Statistics::remark(const std::string& pass, std::string message) {
+    remarks.emplace_back(pass, std::move(message));
+}
+
+void Statistics::printRemarks(std::ostream& out, const std::string& pass) const {
+    for (const auto& [remarkPass, message] : remarks) {
+        if (remarkPass == pass) {
+            out << message << std::endl;
+        }
+    }
+}
+
+} // namespace codegen
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace codegen {
+
+// Counters reported by -stats, grouped by the pass that recorded them in recording order.
+// Passes may also leave remarks, one line per decision, for their own reports.
+class Statistics {
+public:
+    void add(const std::string& pass, const std::string& counter, long value);
+    void print(std::ostream& out) const;
+
+    void remark(const std::string& pass, std::string message);
+    void printRemarks(std::ostream& out, const std::string& pass) const;
+
+private:
+    std::vector<std::pair<std::string, std::vector<std::pair<std::string, long>>>> passes;
+    std::vector<std::pair<std::string, std::string>> remarks;
+};
+
+} // namespace codegen
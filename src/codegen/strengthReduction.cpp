@@ -0,0 +1,132 @@
+#include "strengthReduction.hpp"
+#include <array>
+#include <stdexcept>
+
+namespace isel {
+
+namespace {
+
+// Compile-time checks: every planned sequence must agree with imul and with idiv (truncation
+// toward zero) on the dividends where plans go wrong first: around zero, around multiples of
+// the divisor and at both ends of the int range. `make check-division` covers every dividend.
+
+constexpr bool divisionMatches(int64_t divisor) {
+    DivisionPlan plan = planDivision(divisor);
+    std::array<int64_t, 12> anchors = {0, 1, divisor, -divisor, 2 * divisor, intMax, intMin, intMax / divisor * divisor,
+                                       intMin / divisor * divisor, 1 << 20, -(1 << 20), 123456789};
+    for (int64_t anchor : anchors) {
+        for (int64_t delta = -2; delta <= 2; delta++) {
+            int64_t x = anchor + delta;
+            if (x < intMin || x > intMax) {
+                continue;
+            }
+            if (simulateDivision(plan, x) != x / divisor) {
+                return false;
+            }
+        }
+    }
+    return plan.kind != DivisionKind::None;
+}
+
+constexpr bool multiplyMatches(int64_t factor) {
+    MultiplyPlan plan = planMultiply(factor);
+    if (plan.kind == MultiplyKind::None) {
+        return true;
+    }
+    for (int64_t x : {0LL, 1LL, -1LL, 7LL, -7LL, 1000LL, -1000LL}) {
+        if (simulateMultiply(plan, x) != x * factor) {
+            return false;
+        }
+    }
+    return plan.operations < imulLatency;
+}
+
+constexpr bool allMatch() {
+    for (int64_t constant : sampledConstants) {
+        if (!divisionMatches(constant) || !multiplyMatches(constant)) {
+            return false;
+        }
+    }
+    for (int64_t factor = -100; factor <= 100; factor++) {
+        if (!multiplyMatches(factor)) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(allMatch());
+
+// The shapes each plan was written for
+static_assert(planMultiply(8).kind == MultiplyKind::Shift);
+static_assert(planMultiply(40).kind == MultiplyKind::Lea);
+static_assert(planMultiply(45).kind == MultiplyKind::LeaLea);
+static_assert(planMultiply(33).kind == MultiplyKind::ShiftAdd);
+static_assert(planMultiply(31).kind == MultiplyKind::ShiftSub);
+static_assert(planMultiply(-5).negate && planMultiply(-5).operations == 2);
+static_assert(planMultiply(11).kind == MultiplyKind::None);  // Three operations, imul is as fast
+static_assert(planDivision(7).magic == 2454267027);          // 2^34 / 7 + 1
+static_assert(planDivision(-16).kind == DivisionKind::PowerOfTwo && planDivision(-16).negate);
+
+std::string scaled(const char* base, int scale) {
+    return std::string("lea rax, [") + base + " + " + base + "*" + std::to_string(scale) + "]";
+}
+
+} // namespace
+
+std::string multiplyTemplate(const MultiplyPlan& plan) {
+    std::string sequence;
+    switch (plan.kind) {
+        case MultiplyKind::Shift:
+            if (plan.shift == 0) {
+                sequence = "mov rax, {0}";
+            } else if (plan.shift == 1) {
+                sequence = "lea rax, [{0} + {0}]";
+            } else {
+                sequence = "mov rax, {0}\nshl rax, " + std::to_string(plan.shift);
+            }
+            break;
+        case MultiplyKind::Lea:
+            sequence = scaled("{0}", plan.scale);
+            if (plan.shift > 0) {
+                sequence += "\nshl rax, " + std::to_string(plan.shift);
+            }
+            break;
+        case MultiplyKind::LeaLea:
+            sequence = scaled("{0}", plan.scale) + "\n" + scaled("rax", plan.secondScale);
+            break;
+        case MultiplyKind::ShiftAdd:
+            // {0} may be rax itself, so the shifted copy goes to rcx
+            sequence = "mov rcx, {0}\nshl rcx, " + std::to_string(plan.shift) + "\nlea rax, [rcx + {0}]";
+            break;
+        case MultiplyKind::ShiftSub:
+            sequence = "mov rcx, {0}\nshl rcx, " + std::to_string(plan.shift) + "\nsub rcx, {0}\nmov rax, rcx";
+            break;
+        default:
+            throw std::runtime_error("[isel::multiplyTemplate] No plan for this factor");
+    }
+    return plan.negate ? sequence + "\nneg rax" : sequence;
+}
+
+std::string divisionTemplate(const DivisionPlan& plan) {
+    std::string sequence;
+    if (plan.kind == DivisionKind::PowerOfTwo) {
+        if (plan.shift == 1) {
+            sequence = "mov rcx, rax\nshr rcx, 63\nadd rax, rcx\nsar rax, 1";
+        } else if (plan.shift > 1) {
+            sequence = "mov rcx, rax\nsar rcx, 63\nshr rcx, " + std::to_string(64 - plan.shift) +
+                       "\nadd rax, rcx\nsar rax, " + std::to_string(plan.shift);
+        }
+    } else if (plan.kind == DivisionKind::Magic) {
+        sequence = "mov rcx, " + std::to_string(plan.magic) + "\nimul rax, rcx\nsar rax, " + std::to_string(plan.shift) +
+                   "\nmov rcx, rax\nshr rcx, 63\nadd rax, rcx";
+    } else {
+        throw std::runtime_error("[isel::divisionTemplate] No plan for this divisor");
+    }
+
+    if (plan.negate) {
+        sequence += sequence.empty() ? "neg rax" : "\nneg rax";
+    }
+    return sequence;
+}
+
+} // namespace isel
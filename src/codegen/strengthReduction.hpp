@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Strength reduction of multiplication and division by constants. A plan says which cheaper
+// sequence replaces imul or idiv for a given constant; planning is constexpr so the selector
+// can test it while labelling and the checks in strengthReduction.cpp can run it at compile time.
+// Values live sign-extended in 64-bit registers and fit in an int, which the sequences rely on.
+namespace isel {
+
+enum class MultiplyKind {
+    None,      // Keep imul
+    Shift,     // x << shift
+    Lea,       // lea [x + x*scale], then << shift
+    LeaLea,    // lea [x + x*scale], then lea [t + t*secondScale]
+    ShiftAdd,  // (x << shift) + x
+    ShiftSub,  // (x << shift) - x
+};
+
+struct MultiplyPlan {
+    MultiplyKind kind = MultiplyKind::None;
+    int shift = 0;
+    int scale = 0;
+    int secondScale = 0;
+    bool negate = false;
+    int operations = 0;  // Single-cycle ALU instructions, register copies excluded
+};
+
+enum class DivisionKind {
+    None,        // Keep idiv
+    PowerOfTwo,  // Bias negative dividends by 2^shift - 1, then sar: rounds toward zero
+    Magic,       // (x * magic) >> shift, plus one when negative (Granlund and Montgomery)
+};
+
+struct DivisionPlan {
+    DivisionKind kind = DivisionKind::None;
+    int shift = 0;
+    int64_t magic = 0;
+    bool negate = false;  // Negative divisor: divide by its magnitude, then negate
+};
+
+inline constexpr int imulLatency = 3;
+inline constexpr int64_t intMin = -2147483648LL;
+inline constexpr int64_t intMax = 2147483647LL;
+
+// Constants the compile-time checks in strengthReduction.cpp simulate on chosen dividends and
+// tests/divisionCheck.cpp runs on every int dividend
+inline constexpr std::array<int64_t, 30> sampledConstants = {
+    2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 13, 15, 17, 25, 31, 45, 60, 100, 641, 1000,
+    65536, 65537, 1000000, 1 << 30, intMax, intMin, -2, -3, -7, -1000,
+};
+
+constexpr int log2Exact(int64_t value) {
+    if (value <= 0 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    int log = 0;
+    while ((int64_t{1} << log) != value) {
+        log++;
+    }
+    return log;
+}
+
+// 1 + scale for the lea forms [x + x*2], [x + x*4], [x + x*8], 0 otherwise
+constexpr int leaScale(int64_t factor) {
+    return factor == 3 || factor == 5 || factor == 9 ? static_cast<int>(factor - 1) : 0;
+}
+
+constexpr MultiplyPlan planMultiply(int64_t factor) {
+    MultiplyPlan plan;
+    if (factor == 0 || factor <= intMin || factor > intMax) {
+        return plan;
+    }
+    plan.negate = factor < 0;
+    int64_t magnitude = factor < 0 ? -factor : factor;
+
+    if (int shift = log2Exact(magnitude); shift >= 0) {
+        plan = {MultiplyKind::Shift, shift, 0, 0, plan.negate, shift > 0 ? 1 : 0};
+    } else if (int shift = log2Exact(magnitude & -magnitude); leaScale(magnitude >> shift) != 0) {
+        plan = {MultiplyKind::Lea, shift, leaScale(magnitude >> shift), 0, plan.negate, shift > 0 ? 2 : 1};
+    } else if (log2Exact(magnitude - 1) > 0) {
+        plan = {MultiplyKind::ShiftAdd, log2Exact(magnitude - 1), 0, 0, plan.negate, 2};
+    } else if (log2Exact(magnitude + 1) > 0) {
+        plan = {MultiplyKind::ShiftSub, log2Exact(magnitude + 1), 0, 0, plan.negate, 2};
+    } else {
+        for (int64_t first : {3, 5, 9}) {
+            if (magnitude % first == 0 && leaScale(magnitude / first) != 0) {
+                plan = {MultiplyKind::LeaLea, 0, leaScale(first), leaScale(magnitude / first), plan.negate, 2};
+                break;
+            }
+        }
+    }
+
+    if (plan.kind == MultiplyKind::None) {
+        return MultiplyPlan{};
+    }
+    plan.operations += plan.negate ? 1 : 0;
+
+    // Only worth it while strictly faster than the imul it replaces
+    return plan.operations < imulLatency ? plan : MultiplyPlan{};
+}
+
+constexpr DivisionPlan planDivision(int64_t divisor) {
+    DivisionPlan plan;
+    if (divisor == 0 || divisor == 1 || divisor < intMin || divisor > intMax) {
+        return plan;
+    }
+    plan.negate = divisor < 0;
+    int64_t magnitude = divisor < 0 ? -divisor : divisor;
+
+    if (int shift = log2Exact(magnitude); shift >= 0) {
+        plan.kind = DivisionKind::PowerOfTwo;
+        plan.shift = shift;
+        return plan;
+    }
+
+    // For 32-bit dividends, m = 2^(31+l) / d + 1 with l = ceil(log2 d) lies in [2^31, 2^32), so
+    // x * m fits in a signed 64-bit product and its top bits are the floor of x / d
+    int ceilLog = 0;
+    while ((int64_t{1} << ceilLog) < magnitude) {
+        ceilLog++;
+    }
+    plan.kind = DivisionKind::Magic;
+    plan.shift = 31 + ceilLog;
+    plan.magic = (int64_t{1} << plan.shift) / magnitude + 1;
+    return plan;
+}
+
+// What the planned sequences compute, for the compile-time checks against truncating division
+constexpr int64_t simulateMultiply(const MultiplyPlan& plan, int64_t x) {
+    int64_t result = 0;
+    switch (plan.kind) {
+        case MultiplyKind::Shift:    result = x * (int64_t{1} << plan.shift); break;
+        case MultiplyKind::Lea:      result = (x + x * plan.scale) * (int64_t{1} << plan.shift); break;
+        case MultiplyKind::LeaLea:   result = (x + x * plan.scale) * (1 + plan.secondScale); break;
+        case MultiplyKind::ShiftAdd: result = x * (int64_t{1} << plan.shift) + x; break;
+        case MultiplyKind::ShiftSub: result = x * (int64_t{1} << plan.shift) - x; break;
+        default:                     break;
+    }
+    return plan.negate ? -result : result;
+}
+
+constexpr int64_t simulateDivision(const DivisionPlan& plan, int64_t x) {
+    int64_t result = 0;
+    if (plan.kind == DivisionKind::PowerOfTwo) {
+        // sar rcx, 63 then shr rcx, 64 - shift: 2^shift - 1 for negative x, 0 otherwise
+        int64_t bias = x < 0 ? (int64_t{1} << plan.shift) - 1 : 0;
+        result = (x + bias) >> plan.shift;
+    } else if (plan.kind == DivisionKind::Magic) {
+        int64_t product = (x * plan.magic) >> plan.shift;
+        result = product + (product < 0 ? 1 : 0);  // shr 63 of the floor adds the sign bit
+    }
+    return plan.negate ? -result : result;
+}
+
+// Assembly template for a planned multiply ({0}: the operand, rax or a local's register) or
+// divide (dividend in rax). Both leave the result in rax and may use rcx as scratch.
+std::string multiplyTemplate(const MultiplyPlan& plan);
+std::string divisionTemplate(const DivisionPlan& plan);
+
+} // namespace isel
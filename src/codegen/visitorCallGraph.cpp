@@ -0,0 +1,189 @@
+#include "visitorCallGraph.hpp"
+#include <algorithm>
+#include <functional>
+
+bool CallGraph::isDefined(const std::string& function) const {
+    return callees.count(function) > 0;
+}
+
+bool CallGraph::isRecursive(const std::string& function) const {
+    auto it = componentOf.find(function);
+    if (it == componentOf.end()) {
+        return false;
+    }
+    if (components[it->second].size() > 1) {
+        return true;
+    }
+    const auto& direct = callees.at(function);
+    return std::find(direct.begin(), direct.end(), function) != direct.end();
+}
+
+bool CallGraph::inSameComponent(const std::string& a, const std::string& b) const {
+    auto itA = componentOf.find(a);
+    auto itB = componentOf.find(b);
+    return itA != componentOf.end() && itB != componentOf.end() && itA->second == itB->second;
+}
+
+bool CallGraph::isExported(const std::string& function) {
+    return function == "main";
+}
+
+Purity CallGraph::purityOf(const std::string& function) const {
+    auto it = purity.find(function);
+    return it != purity.end() ? it->second : Purity::SideEffecting;
+}
+
+VisitorCallGraph::VisitorCallGraph()
+    : graph(), currentCallees(nullptr) {}
+
+CallGraph VisitorCallGraph::analyze(const NodeProgram& ast) {
+    graph = CallGraph();
+    looping.clear();
+    for (const auto& function : ast.functions) {
+        visitFunction(function);
+    }
+    buildComponents();
+    classifyPurity();
+    return std::move(graph);
+}
+
+void VisitorCallGraph::visitFunction(const NodeFunction& function) {
+    graph.functions.push_back(function.name);
+    currentCallees = &graph.callees[function.name];
+    visitCompoundStatement(function.body);
+    currentCallees = nullptr;
+}
+
+void VisitorCallGraph::visitCompoundStatement(const NodeCompoundStatement& compound) {
+    for (const auto& statement : compound.statements) {
+        visitStatement(statement);
+    }
+}
+
+void VisitorCallGraph::visitStatement(const NodeStatement& statement) {
+    std::visit([this](const auto& stmt) {
+        using T = std::decay_t<decltype(stmt)>;
+        if constexpr (std::is_same_v<T, NodeStatementEmpty>) {
+            // IGNORE empty statements, they call nothing
+        } else if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+            if (stmt.expression.has_value()) {
+                visitExpression(stmt.expression.value());
+            }
+        } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+            if (stmt.initializer.has_value()) {
+                visitExpression(stmt.initializer.value());
+            }
+        } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+            visitExpression(stmt.expression);
+        } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+            visitExpression(stmt.condition);
+            visitCompoundStatement(*stmt.body);
+            if (stmt.elseBody.has_value()) {
+                visitCompoundStatement(*stmt.elseBody.value());
+            }
+        } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+            looping.insert(graph.functions.back());
+            visitExpression(stmt.condition);
+            visitCompoundStatement(*stmt.body);
+        } else {
+            throw std::runtime_error("[VisitorCallGraph::visitStatement] Unknown statement type");
+        }
+    }, statement.value);
+}
+
+void VisitorCallGraph::visitExpression(const NodeExpression& expression) {
+    std::visit([this](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            visitExpressionPrimary(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionBinary> || std::is_same_v<T, NodeExpressionComparison>) {
+            visitExpression(*expr.left);
+            visitExpression(*expr.right);
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            visitExpressionFunctionCall(expr);
+        } else {
+            throw std::runtime_error("[VisitorCallGraph::visitExpression] Unknown expression type");
+        }
+    }, expression.value);
+}
+
+void VisitorCallGraph::visitExpressionPrimary(const NodeExpressionPrimary& primary) {
+    if (std::holds_alternative<std::unique_ptr<NodeExpression>>(primary.value)) {
+        visitExpression(*std::get<std::unique_ptr<NodeExpression>>(primary.value));
+    }
+}
+
+void VisitorCallGraph::visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall) {
+    if (std::find(currentCallees->begin(), currentCallees->end(), funcCall.functionName) == currentCallees->end()) {
+        currentCallees->push_back(funcCall.functionName);
+    }
+    for (const auto& arg : funcCall.arguments) {
+        visitExpression(arg);
+    }
+}
+
+void VisitorCallGraph::buildComponents() {
+    // Tarjan's algorithm: components are completed callees first
+    std::unordered_map<std::string, int> index;
+    std::unordered_map<std::string, int> lowLink;
+    std::unordered_set<std::string> onStack;
+    std::vector<std::string> stack;
+    int counter = 0;
+
+    std::function<void(const std::string&)> connect = [&](const std::string& function) {
+        index[function] = lowLink[function] = counter++;
+        stack.push_back(function);
+        onStack.insert(function);
+
+        for (const auto& callee : graph.callees[function]) {
+            if (!graph.isDefined(callee)) {
+                continue;
+            }
+            if (!index.count(callee)) {
+                connect(callee);
+                lowLink[function] = std::min(lowLink[function], lowLink[callee]);
+            } else if (onStack.count(callee)) {
+                lowLink[function] = std::min(lowLink[function], index[callee]);
+            }
+        }
+
+        if (lowLink[function] == index[function]) {
+            std::vector<std::string> component;
+            std::string member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack.erase(member);
+                graph.componentOf[member] = graph.components.size();
+                component.push_back(member);
+            } while (member != function);
+            graph.components.push_back(std::move(component));
+        }
+    };
+
+    for (const auto& function : graph.functions) {
+        if (!index.count(function)) {
+            connect(function);
+        }
+    }
+}
+
+void VisitorCallGraph::classifyPurity() {
+    // Components come callees first, so every callee outside the component is classified
+    for (const auto& component : graph.components) {
+        Purity purity = graph.isRecursive(component.front()) ? Purity::ReadOnly : Purity::Pure;
+        for (const auto& member : component) {
+            if (looping.count(member)) {
+                purity = std::max(purity, Purity::ReadOnly);
+            }
+            for (const auto& callee : graph.callees[member]) {
+                if (!graph.inSameComponent(member, callee)) {
+                    purity = std::max(purity, graph.purityOf(callee));
+                }
+            }
+        }
+        for (const auto& member : component) {
+            graph.purity[member] = purity;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include "astVisitor.hpp"
+
+/* What a call can do besides computing its result. The language has no globals or pointers, so
+   a function can only see its arguments; what remains is whether a call may not return (a
+   loop or recursion) and calls to functions defined elsewhere, which may do anything. */
+enum class Purity {
+    Pure,           // Always returns, the result depends on the arguments alone: calls can go
+    ReadOnly,       // Writes nothing but may not return: calls can be reused, never dropped
+    SideEffecting,  // Reaches a function without a body
+};
+
+struct CallGraph {
+    std::vector<std::string> functions;  // Source order
+    std::unordered_map<std::string, std::vector<std::string>> callees;
+
+    // Strongly connected components, every component listed after all the ones it calls
+    std::vector<std::vector<std::string>> components;
+    std::unordered_map<std::string, size_t> componentOf;
+    std::unordered_map<std::string, Purity> purity;
+
+    bool isDefined(const std::string& function) const;
+    bool isRecursive(const std::string& function) const;
+    bool inSameComponent(const std::string& a, const std::string& b) const;
+    Purity purityOf(const std::string& function) const;  // SideEffecting when not defined
+
+    // Only main is reachable from outside the program, through _start
+    static bool isExported(const std::string& function);
+};
+
+class VisitorCallGraph : public AstVisitor<VisitorCallGraph> {
+public:
+    VisitorCallGraph();
+
+    CallGraph analyze(const NodeProgram& ast);
+
+private:
+    CallGraph graph;
+    std::vector<std::string>* currentCallees;
+    std::unordered_set<std::string> looping;  // Functions containing a while loop
+
+    void visitFunction(const NodeFunction& function);
+    void visitCompoundStatement(const NodeCompoundStatement& compound);
+    void visitStatement(const NodeStatement& statement);
+    void visitExpression(const NodeExpression& expression);
+
+    void visitExpressionPrimary(const NodeExpressionPrimary& primary);
+    void visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall);
+
+    void buildComponents();
+    void classifyPurity();
+};
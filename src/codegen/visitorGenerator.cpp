@@ -1,11 +1,87 @@
 #include "visitorGenerator.hpp"
+#include "visitorCallGraph.hpp"
 #include <assert.h>
 #include <iostream>
+#include <algorithm>
+#include <climits>
+#include <regex>
 
-VisitorGenerator::VisitorGenerator(ScopeNode* rootScope)
-    : asmOutput(""), currentScope(rootScope), childScopeIndexes(), labelCounter(0) {}
+VisitorGenerator::VisitorGenerator(ScopeNode* rootScope, const std::unordered_map<std::string, FunctionAllocation>& allocations,
+                                   const codegen::Options& options)
+    : asmOutput(""), currentScope(rootScope), childScopeIndexes(), labelCounter(0), options(options), memoizing(false),
+      allocations(allocations), currentAllocation(nullptr), frame(Frame::BasePointer), frameSize(0),
+      redZoneSpills(0), redZoneExhausted(false), multipliesReduced(0), divisionsReduced(0), recursiveCallsLooped(0),
+      siblingCallsJumped(0), functionsMemoized(0) {}
 
-std::string VisitorGenerator::generate(const NodeProgram& ast) {
+void VisitorGenerator::generateFunction(const NodeProgram& ast, size_t index, bool memoized) {
+    // Functions may be generated in any order, the scope of function i is child i of the root
+    asmOutput.clear();
+    clobberedRegisters.clear();
+
+    int firstLabel = labelCounter;
+    int firstMultiplies = multipliesReduced;
+    int firstDivisions = divisionsReduced;
+    int firstLooped = recursiveCallsLooped;
+    int firstJumped = siblingCallsJumped;
+    memoizing = memoized;
+    childScopeIndexes.push_back(static_cast<int>(index));
+    visitFunction(ast.functions[index], true);
+    childScopeIndexes.pop_back();
+
+    // Spills of a very deep expression tree did not fit below the red-zone locals
+    if (redZoneExhausted) {
+        asmOutput.clear();
+        labelCounter = firstLabel;
+        multipliesReduced = firstMultiplies;
+        divisionsReduced = firstDivisions;
+        recursiveCallsLooped = firstLooped;
+        siblingCallsJumped = firstJumped;
+        childScopeIndexes.push_back(static_cast<int>(index));
+        visitFunction(ast.functions[index], false);
+        childScopeIndexes.pop_back();
+    }
+
+    const NodeFunction& function = ast.functions[index];
+    std::string code = optimizeFunction(asmOutput);
+    functionOutputs[function.name] = memoized ? memoize(function, code) : code;
+    asmOutput.clear();
+    memoizing = false;
+}
+
+const RegisterSet& VisitorGenerator::getClobberedRegisters() const {
+    return clobberedRegisters;
+}
+
+const peephole::Optimizer& VisitorGenerator::getPeephole() const {
+    return peephole;
+}
+
+const BlockLayout& VisitorGenerator::getLayout() const {
+    return layout;
+}
+
+int VisitorGenerator::getMultipliesReduced() const {
+    return multipliesReduced;
+}
+
+int VisitorGenerator::getDivisionsReduced() const {
+    return divisionsReduced;
+}
+
+int VisitorGenerator::getRecursiveCallsLooped() const {
+    return recursiveCallsLooped;
+}
+
+int VisitorGenerator::getSiblingCallsJumped() const {
+    return siblingCallsJumped;
+}
+
+int VisitorGenerator::getFunctionsMemoized() const {
+    return functionsMemoized;
+}
+
+std::string VisitorGenerator::assemble(const NodeProgram& ast) {
+    asmOutput.clear();
     writeAsm(".intel_syntax noprefix");
     writeAsm(".section .text");
     writeAsm("    .globl _start");
@@ -16,33 +92,84 @@ std::string VisitorGenerator::generate(const NodeProgram& ast) {
     writeAsm("    mov rax, 60");
     writeAsm("    syscall");
     writeAsm("");
-    
-    childScopeIndexes.push_back(0);
+
     for (const auto& function : ast.functions) {
-        visitFunction(function);
+        auto outputIt = functionOutputs.find(function.name);
+        if (outputIt == functionOutputs.end()) {
+            throw std::runtime_error("[VisitorGenerator::assemble] Function '" + function.name + "' was not generated");
+        }
+        asmOutput += outputIt->second;
     }
-    childScopeIndexes.pop_back();
     return asmOutput;
 }
 
-void VisitorGenerator::visitFunction(const NodeFunction& function) {
+void VisitorGenerator::visitFunction(const NodeFunction& function, bool allowRedZone) {
     currentScope = &currentScope->getChild(childScopeIndexes.back()++);
 
-    writeAsm(".globl " + function.name);
-    writeAsm(function.name + ":");
-    writeAsm("push rbp");
-    writeAsm("mov rbp, rsp");
+    auto allocationIt = allocations.find(function.name);
+    if (allocationIt == allocations.end()) {
+        throw std::runtime_error("[VisitorGenerator::visitFunction] No register allocation for function '" + function.name + "'");
+    }
+    currentAllocation = &allocationIt->second;
+    freeTemporaries = currentAllocation->temporaryRegisters;
+    busyTemporaries.clear();
 
-    int functionFrameSize = currentScope->getFrameSize();
-    writeAsm("sub rsp, " + std::to_string(functionFrameSize));
+    // Scratch registers and every register given to a local count as written
+    clobberedRegisters = currentAllocation->localRegisters;
+    clobberedRegisters.insert({"rax", "rcx", "rdx"});
+
+    if (CallGraph::isExported(function.name)) {
+        writeAsm(".globl " + function.name);
+    }
+    // A memoized function's own label belongs to the cache lookup in front of the body
+    writeAsm((memoizing ? function.name + ".body" : function.name) + ":");
+
+    // Without stack slots no frame is needed at all. A leaf function keeps its slots in the
+    // red zone below rsp, which nothing overwrites while it makes no calls and pushes nothing.
+    frameSize = currentScope->getFrameSize();
+    redZoneExhausted = false;
+    redZoneSpills = 0;
+    if (frameSize == 0) {
+        frame = Frame::None;
+    } else if (allowRedZone && currentAllocation->callClobbers.empty() && frameSize <= redZoneSize) {
+        frame = Frame::RedZone;
+    } else {
+        frame = Frame::BasePointer;
+        writeAsm("push rbp");
+        writeAsm("mov rbp, rsp");
+        writeAsm("sub rsp, " + std::to_string(frameSize));
+    }
+
+    // Callee-saved registers are pushed below the locals and popped again by emitEpilogue,
+    // red-zone slots are addressed from rsp after these pushes
+    for (const auto& reg : currentAllocation->calleeSavedUsed) {
+        writeAsm("push " + reg);
+    }
+
+    // A recursive call in tail position jumps back here with the new arguments in registers,
+    // the frame and the saved registers stay as they are
+    functionName = function.name;
+    entryLabel = "tail_entry_" + std::to_string(labelCounter++);
+    if (options.optimizationLevel >= 1) {
+        writeAsm(entryLabel + ":");
+    }
 
     setupFunctionParameters(function);
 
+    // In size mode every return jumps to a single epilogue at the end of the function
+    returnLabel = options.optimizeSize ? "return_label_" + std::to_string(labelCounter++) : "";
+
     childScopeIndexes.push_back(0);
     visitCompoundStatement(function.body);
     childScopeIndexes.pop_back();
-    
+
+    if (options.optimizeSize) {
+        writeAsm(returnLabel + ":");
+        emitEpilogue();
+    }
+
     currentScope = currentScope->getParent();
+    currentAllocation = nullptr;
 }
 
 void VisitorGenerator::visitCompoundStatement(const NodeCompoundStatement& compound) {
@@ -79,69 +206,88 @@ void VisitorGenerator::visitStatement(const NodeStatement& statement) {
 }
 
 void VisitorGenerator::visitExpression(const NodeExpression& expression) {
-    std::visit([this](const auto& expr) {
-        using T = std::decay_t<decltype(expr)>;
-        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
-            visitExpressionPrimary(expr);
-        } else if constexpr (std::is_same_v<T, NodeExpressionBinary>) {
-            visitExpressionBinary(expr);
-        } else if constexpr (std::is_same_v<T, NodeExpressionComparison>) {
-            visitExpressionComparison(expr);
-        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
-            visitExpressionFunctionCall(expr);
-        } else {
-            throw std::runtime_error("[VisitorGenerator::visitExpression] Unknown expression type");
-        }
-    }, expression.value);
+    // Expressions are tiled as a whole by the instruction selector, the result ends up in rax
+    Selection selection;
+    int root = buildSelectionTree(selection, expression);
+    emitSelection(selection, root, isel::NonTerminal::Reg);
 }
 
 void VisitorGenerator::visitStatementVarDecl(const NodeStatementVarDecl& varDecl) {
-    auto offsetOpt = currentScope->getOffset(varDecl.identifier);
-    if (!offsetOpt.has_value()) {
+    if (!currentScope->getOffset(varDecl.identifier).has_value()) {
         throw std::runtime_error("[VisitorGenerator::visitStatementVarDecl] Variable '" + varDecl.identifier + "' not found in scope");
     }
-    int offset = offsetOpt.value();
 
-    // If there's an initializer, compute its value and store it
-    if (varDecl.initializer.has_value()) {
-        visitExpression(varDecl.initializer.value());
-        writeAsm("mov [rbp - " + std::to_string(offset) + "], rax");
-    }
-    else {
-        writeAsm("mov qword ptr [rbp - " + std::to_string(offset) + "], 0");
+    // Without an initializer the variable is zeroed, unless nothing can read the zero
+    if (!varDecl.initializer.has_value() && !varDecl.zeroed) {
+        return;
     }
+
+    Selection selection;
+    int target = addVariableLeaf(selection, varDecl.identifier, "visitStatementVarDecl");
+    int value = varDecl.initializer.has_value()
+        ? buildSelectionTree(selection, varDecl.initializer.value())
+        : addSelectionNode(selection, nullptr, isel::Op::Const);
+    int root = addSelectionNode(selection, nullptr, isel::Op::Store, target, value);
+    emitSelection(selection, root, isel::NonTerminal::Stmt);
 }
 
 void VisitorGenerator::visitStatementReturn(const NodeStatementReturn& returnStmt) {
+    if (returnStmt.expression.has_value() && options.optimizationLevel >= 1) {
+        const NodeExpression& value = unwrapGrouping(returnStmt.expression.value());
+        if (const auto* call = std::get_if<NodeExpressionFunctionCall>(&value.value)) {
+            emitTailCall(*call);
+            return;
+        }
+    }
+
     if (returnStmt.expression.has_value()) {
         visitExpression(returnStmt.expression.value());
     } else {
         writeAsm("mov rax, 0");
     }
-    writeAsm("leave");
-    writeAsm("ret\n");
+
+    if (options.optimizeSize) {
+        writeAsm("jmp " + returnLabel);
+    } else {
+        emitEpilogue();
+    }
 }
 
 void VisitorGenerator::visitStatementAssignment(const NodeStatementAssignment& assignment) {
-    auto offsetOpt = currentScope->getOffsetRecursive(assignment.identifier);
-    if (!offsetOpt.has_value()) {
-        throw std::runtime_error("[VisitorGenerator::visitStatementAssignment] Variable '" + assignment.identifier + "' not found in scope");
-    }
-    int offset = offsetOpt.value();
+    Selection selection;
+    int target = addVariableLeaf(selection, assignment.identifier, "visitStatementAssignment");
+
+    // x = x + e, x = e + x and x = x - e update the variable in place
+    auto isTarget = [&assignment](const NodeExpression& expression) {
+        const auto* primary = std::get_if<NodeExpressionPrimary>(&unwrapGrouping(expression).value);
+        const auto* name = primary ? std::get_if<std::string>(&primary->value) : nullptr;
+        return name && *name == assignment.identifier;
+    };
 
-    visitExpression(assignment.expression);
+    int root = -1;
+    const auto* binary = std::get_if<NodeExpressionBinary>(&unwrapGrouping(assignment.expression).value);
+    if (binary && binary->op == NodeExpressionBinary::BinaryOperator::Add && isTarget(*binary->left)) {
+        root = addSelectionNode(selection, nullptr, isel::Op::AddTo, target, buildSelectionTree(selection, *binary->right));
+    } else if (binary && binary->op == NodeExpressionBinary::BinaryOperator::Add && isTarget(*binary->right)) {
+        root = addSelectionNode(selection, nullptr, isel::Op::AddTo, target, buildSelectionTree(selection, *binary->left));
+    } else if (binary && binary->op == NodeExpressionBinary::BinaryOperator::Subtract && isTarget(*binary->left)) {
+        root = addSelectionNode(selection, nullptr, isel::Op::SubTo, target, buildSelectionTree(selection, *binary->right));
+    } else {
+        root = addSelectionNode(selection, nullptr, isel::Op::Store, target, buildSelectionTree(selection, assignment.expression));
+    }
 
-    writeAsm("mov [rbp - " + std::to_string(offset) + "], rax");
+    emitSelection(selection, root, isel::NonTerminal::Stmt);
 }
 
 void VisitorGenerator::visitStatementIf(const NodeStatementIf& ifStmt) {
+    if (options.optimizationLevel >= 1 && tryIfConversion(ifStmt)) {
+        return;
+    }
+
     const std::string elseLabel = "else_label_" + std::to_string(labelCounter++);
     const std::string endLabel = "end_label_" + std::to_string(labelCounter++);
 
-    visitExpression(ifStmt.condition);
-
-    writeAsm("test rax, rax");
-    writeAsm("jz " + elseLabel);
+    emitBranchUnless(ifStmt.condition, elseLabel);
 
     visitCompoundStatement(*ifStmt.body);
     writeAsm("jmp " + endLabel);
@@ -157,142 +303,865 @@ void VisitorGenerator::visitStatementWhile(const NodeStatementWhile& whileStmt)
     const std::string startLabel = "while_start_" + std::to_string(labelCounter++);
     const std::string endLabel = "while_end_" + std::to_string(labelCounter++);
 
-    writeAsm(startLabel + ":");
-
-    visitExpression(whileStmt.condition);
-    writeAsm("test rax, rax");
-    writeAsm("jz " + endLabel);
+    // Rotated loop: the condition is tested at the bottom, so an iteration takes a single
+    // backward branch. The first test is a guard in front of the loop, or in size mode a
+    // jump straight to the bottom test so the condition is emitted once.
+    std::string testLabel;
+    if (options.optimizeSize) {
+        testLabel = "while_test_" + std::to_string(labelCounter++);
+        writeAsm("jmp " + testLabel);
+    } else {
+        emitBranchUnless(whileStmt.condition, endLabel);
+    }
 
+    writeAsm(startLabel + ":");
     visitCompoundStatement(*whileStmt.body);
-    
-    writeAsm("jmp " + startLabel);
+
+    if (options.optimizeSize) {
+        writeAsm(testLabel + ":");
+    }
+    emitBranchIf(whileStmt.condition, startLabel);
     writeAsm(endLabel + ":");
 }
 
-void VisitorGenerator::visitExpressionPrimary(const NodeExpressionPrimary& primary) {
-    std::visit([this](const auto& value) {
-        using T = std::decay_t<decltype(value)>;
+bool VisitorGenerator::tryIfConversion(const NodeStatementIf& ifStmt) {
+    // Diamonds (if/else assigning one variable) and triangles (if assigning it) become a
+    // conditional move when both values are cheap to compute and safe to compute unconditionally
+    const NodeStatementAssignment* thenAssignment = singleAssignment(*ifStmt.body);
+    const NodeStatementAssignment* elseAssignment = nullptr;
+    if (!thenAssignment) {
+        return false;
+    }
+    if (ifStmt.elseBody.has_value()) {
+        elseAssignment = singleAssignment(*ifStmt.elseBody.value());
+        if (!elseAssignment || elseAssignment->identifier != thenAssignment->identifier) {
+            return false;
+        }
+    }
 
-        if constexpr (std::is_same_v<T, int>) {
-            writeAsm("mov rax, " + std::to_string(value));
-        } else if constexpr (std::is_same_v<T, std::string>) {
-            auto offsetOpt = currentScope->getOffsetRecursive(value);
-            if (!offsetOpt.has_value()) {
-                throw std::runtime_error("[VisitorGenerator::visitExpressionPrimary] Unknown identifier: " + value);
-            }
-            int offset = offsetOpt.value();
-            writeAsm("mov rax, [rbp - " + std::to_string(offset) + "]");
-        } else if constexpr (std::is_same_v<T, std::unique_ptr<NodeExpression>>) {
-            visitExpression(*value);
-        } else {
-            throw std::runtime_error("[VisitorGenerator::visitExpressionPrimary] Unknown primary type");
-        }
-    }, primary.value);
-}
-
-void VisitorGenerator::visitExpressionBinary(const NodeExpressionBinary& binary) {
-    visitExpression(*binary.left);
-    writeAsm("push rax");
-
-    visitExpression(*binary.right);
-    writeAsm("mov rbx, rax");
-
-    writeAsm("pop rax");
-
-    switch (binary.op) {
-        case NodeExpressionBinary::BinaryOperator::Add:
-            writeAsm("add rax, rbx");
-            break;
-        case NodeExpressionBinary::BinaryOperator::Subtract:
-            writeAsm("sub rax, rbx");
-            break;
-        case NodeExpressionBinary::BinaryOperator::Multiply:
-            writeAsm("imul rax, rbx");
-            break;
-        case NodeExpressionBinary::BinaryOperator::Divide:
-            writeAsm("cqo");
-            writeAsm("idiv rbx");
-            break;
-        default:
-            throw std::runtime_error("[VisitorGenerator::visitExpressionBinary] Unknown binary operator");
-    }
-}
-
-void VisitorGenerator::visitExpressionComparison(const NodeExpressionComparison& comparison) {
-    visitExpression(*comparison.left);
-    writeAsm("push rax");
-
-    visitExpression(*comparison.right);
-    writeAsm("mov rbx, rax");
-
-    writeAsm("pop rax");
-
-    switch (comparison.op) {
-        case NodeExpressionComparison::ComparisonOperator::Equal:
-            writeAsm("cmp rax, rbx");
-            writeAsm("sete al");
-            break;
-        case NodeExpressionComparison::ComparisonOperator::NotEqual:
-            writeAsm("cmp rax, rbx");
-            writeAsm("setne al");
-            break;
-        case NodeExpressionComparison::ComparisonOperator::LessThan:
-            writeAsm("cmp rax, rbx");
-            writeAsm("setl al");
-            break;
-        case NodeExpressionComparison::ComparisonOperator::LessThanEqual:
-            writeAsm("cmp rax, rbx");
-            writeAsm("setle al");
-            break;
-        case NodeExpressionComparison::ComparisonOperator::GreaterThan:
-            writeAsm("cmp rax, rbx");
-            writeAsm("setg al");
-            break;
-        case NodeExpressionComparison::ComparisonOperator::GreaterThanEqual:
-            writeAsm("cmp rax, rbx");
-            writeAsm("setge al");
-            break;
-        default:
-            throw std::runtime_error("[VisitorGenerator::visitExpressionComparison] Unknown comparison operator");
+    int thenCost = speculationCost(thenAssignment->expression);
+    int elseCost = elseAssignment ? speculationCost(elseAssignment->expression) : 0;
+    if (thenCost < 0 || elseCost < 0 || thenCost + elseCost > ifConversionBudget) {
+        return false;
     }
 
-    // Convert the result to a 64-bit integer
-    writeAsm("movzx rax, al");
+    auto constant = [](const NodeExpression& expression) -> std::optional<int> {
+        const auto* primary = std::get_if<NodeExpressionPrimary>(&unwrapGrouping(expression).value);
+        const auto* value = primary ? std::get_if<int>(&primary->value) : nullptr;
+        return value ? std::optional<int>(*value) : std::nullopt;
+    };
+
+    int skippedScopes = elseAssignment ? 2 : 1;
+    std::string target = variableLocation(thenAssignment->identifier, "tryIfConversion");
+
+    // x = 1 / x = 0 stores the condition itself
+    if (elseAssignment) {
+        auto thenValue = constant(thenAssignment->expression);
+        auto elseValue = constant(elseAssignment->expression);
+        if (thenValue.has_value() && elseValue.has_value() &&
+            ((thenValue == 1 && elseValue == 0) || (thenValue == 0 && elseValue == 1))) {
+            Selection selection;
+            int leaf = addVariableLeaf(selection, thenAssignment->identifier, "tryIfConversion");
+            int value = addConditionNode(selection, ifStmt.condition, thenValue == 0);
+            emitSelection(selection, addSelectionNode(selection, nullptr, isel::Op::Store, leaf, value), isel::NonTerminal::Stmt);
+            childScopeIndexes.back() += skippedScopes;
+            return true;
+        }
+    }
+
+    // Variables are moved straight from their location, other values through a temporary
+    std::vector<std::string> temporaries;
+    auto operand = [&](const NodeExpression& expression) -> std::optional<std::string> {
+        const auto* primary = std::get_if<NodeExpressionPrimary>(&unwrapGrouping(expression).value);
+        if (const auto* name = primary ? std::get_if<std::string>(&primary->value) : nullptr) {
+            std::string location = variableLocation(*name, "tryIfConversion");
+            return location.front() == '[' ? "qword ptr " + location : location;
+        }
+        auto temporary = acquireTemporary();
+        if (temporary.has_value()) {
+            temporaries.push_back(temporary.value());
+            visitExpression(expression);
+            writeAsm("mov " + temporary.value() + ", rax");
+        }
+        return temporary;
+    };
+
+    bool inMemory = target.front() == '[';
+    std::string destination = inMemory ? "rax" : target;
+    std::string current = inMemory ? "qword ptr " + target : target;
+
+    // Temporaries are checked before anything is emitted
+    size_t needed = 0;
+    for (const auto* assignment : {thenAssignment, elseAssignment}) {
+        const auto* primary = assignment ? std::get_if<NodeExpressionPrimary>(&unwrapGrouping(assignment->expression).value) : nullptr;
+        if (assignment && !(primary && std::holds_alternative<std::string>(primary->value))) {
+            needed++;
+        }
+    }
+    if (freeTemporaries.size() < needed) {
+        return false;
+    }
+
+    std::string thenValue = operand(thenAssignment->expression).value();
+    std::string elseValue = elseAssignment ? operand(elseAssignment->expression).value() : current;
+
+    isel::Condition condition = emitCondition(ifStmt.condition);
+    std::string taken = "cmov" + conditionSuffix(condition) + " ";
+    std::string notTaken = "cmov" + conditionSuffix(isel::negated(condition)) + " ";
+
+    // Plain moves leave the flags alone
+    if (inMemory) {
+        writeAsm("mov rax, " + elseValue);
+        writeAsm(taken + "rax, " + thenValue);
+        writeAsm("mov " + current + ", rax");
+    } else if (elseValue == destination) {
+        writeAsm(taken + destination + ", " + thenValue);
+    } else if (thenValue == destination) {
+        writeAsm(notTaken + destination + ", " + elseValue);
+    } else {
+        writeAsm("mov " + destination + ", " + elseValue);
+        writeAsm(taken + destination + ", " + thenValue);
+    }
+
+    for (const auto& temporary : temporaries) {
+        releaseTemporary(temporary);
+    }
+
+    // The bodies were never visited, their (empty) scopes are skipped
+    childScopeIndexes.back() += skippedScopes;
+    return true;
+}
+
+const NodeStatementAssignment* VisitorGenerator::singleAssignment(const NodeCompoundStatement& compound) {
+    if (compound.statements.size() != 1) {
+        return nullptr;
+    }
+    return std::get_if<NodeStatementAssignment>(&compound.statements.front().value);
+}
+
+int VisitorGenerator::speculationCost(const NodeExpression& expression) {
+    // Rough latency of computing the expression, or -1 when it must not run speculatively:
+    // calls may be arbitrarily expensive and a division may trap
+    const NodeExpression& expr = unwrapGrouping(expression);
+
+    if (std::holds_alternative<NodeExpressionPrimary>(expr.value)) {
+        return 0;
+    }
+    if (const auto* binary = std::get_if<NodeExpressionBinary>(&expr.value)) {
+        if (binary->op == NodeExpressionBinary::BinaryOperator::Divide) {
+            return -1;
+        }
+        int left = speculationCost(*binary->left);
+        int right = speculationCost(*binary->right);
+        if (left < 0 || right < 0) {
+            return -1;
+        }
+        return left + right + (binary->op == NodeExpressionBinary::BinaryOperator::Multiply ? 3 : 1);
+    }
+    if (const auto* comparison = std::get_if<NodeExpressionComparison>(&expr.value)) {
+        int left = speculationCost(*comparison->left);
+        int right = speculationCost(*comparison->right);
+        if (left < 0 || right < 0) {
+            return -1;
+        }
+        return left + right + 2;
+    }
+    return -1;
+}
+
+int VisitorGenerator::addConditionNode(Selection& selection, const NodeExpression& condition, bool negate) {
+    // A comparison is used as is, any other value v as v != 0
+    const NodeExpression& expr = unwrapGrouping(condition);
+    if (const auto* comparison = std::get_if<NodeExpressionComparison>(&expr.value)) {
+        int left = buildSelectionTree(selection, *comparison->left);
+        int right = buildSelectionTree(selection, *comparison->right);
+        isel::Condition cc = comparisonCondition(comparison->op);
+        return addSelectionNode(selection, &expr, isel::Op::Cmp, left, right, 0, negate ? isel::negated(cc) : cc);
+    }
+
+    int value = buildSelectionTree(selection, expr);
+    int zero = addSelectionNode(selection, nullptr, isel::Op::Const);
+    isel::Condition cc = negate ? isel::Condition::Equal : isel::Condition::NotEqual;
+    return addSelectionNode(selection, nullptr, isel::Op::Cmp, value, zero, 0, cc);
 }
 
 void VisitorGenerator::visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall) {
+    // Caller-saved registers holding locals that outlive the call
+    static const std::vector<std::string> noSaves;
+    auto savesIt = currentAllocation->savedAroundCall.find(&funcCall);
+    const auto& saves = savesIt != currentAllocation->savedAroundCall.end() ? savesIt->second : noSaves;
+
+    // Temporaries holding operands of an enclosing expression too, if the call overwrites them
+    const auto& clobbers = currentAllocation->callClobbers.at(&funcCall);
+    clobberedRegisters.insert(clobbers.begin(), clobbers.end());
+
+    std::vector<std::string> pushed = saves;
+    std::copy_if(busyTemporaries.begin(), busyTemporaries.end(), std::back_inserter(pushed), [&clobbers](const std::string& reg) {
+        return clobbers.count(reg) > 0;
+    });
+
+    for (const auto& reg : pushed) {
+        writeAsm("push " + reg);
+    }
+
     setupFunctionCallArguments(funcCall.arguments);
     
     writeAsm("call " + funcCall.functionName);
+
+    for (auto it = pushed.rbegin(); it != pushed.rend(); ++it) {
+        writeAsm("pop " + *it);
+    }
+}
+
+void VisitorGenerator::emitTailCall(const NodeExpressionFunctionCall& funcCall) {
+    // Nothing of the caller is needed after a call in tail position: no register is saved
+    // around it and the callee returns straight to the caller's caller
+    const auto& clobbers = currentAllocation->callClobbers.at(&funcCall);
+    clobberedRegisters.insert(clobbers.begin(), clobbers.end());
+
+    setupFunctionCallArguments(funcCall.arguments);
+
+    if (funcCall.functionName == functionName) {
+        writeAsm("jmp " + entryLabel);
+        recursiveCallsLooped++;
+        return;
+    }
+
+    restoreFrame();
+    writeAsm("jmp " + funcCall.functionName);
+    siblingCallsJumped++;
 }
 
 void VisitorGenerator::writeAsm(const std::string& code) {
     asmOutput += code + "\n";
 }
 
-const std::vector<std::string>& VisitorGenerator::getArgRegisters() {
-    static const std::vector<std::string> argRegs = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
-    return argRegs;
+std::string VisitorGenerator::variableLocation(const std::string& name, const std::string& caller) const {
+    auto locationOpt = currentScope->getLocationRecursive(name, frame == Frame::BasePointer ? "rbp" : "rsp");
+    if (!locationOpt.has_value()) {
+        throw std::runtime_error("[VisitorGenerator::" + caller + "] Unknown identifier: " + name);
+    }
+    return locationOpt.value();
+}
+
+const NodeExpression& VisitorGenerator::unwrapGrouping(const NodeExpression& expression) {
+    const auto* primary = std::get_if<NodeExpressionPrimary>(&expression.value);
+    if (primary && std::holds_alternative<std::unique_ptr<NodeExpression>>(primary->value)) {
+        return unwrapGrouping(*std::get<std::unique_ptr<NodeExpression>>(primary->value));
+    }
+    return expression;
+}
+
+std::optional<int> VisitorGenerator::literalValue(const NodeExpression& expression) {
+    // Decided conditions (if (1) left by dead code elimination, while (1)) need no test
+    const auto* primary = std::get_if<NodeExpressionPrimary>(&unwrapGrouping(expression).value);
+    const auto* value = primary ? std::get_if<int>(&primary->value) : nullptr;
+    return value ? std::optional<int>(*value) : std::nullopt;
+}
+
+int VisitorGenerator::addSelectionNode(Selection& selection, const NodeExpression* source, isel::Op op,
+                                       int left, int right, int64_t value, isel::Condition condition) {
+    selection.sources.push_back(source);
+    selection.operands.emplace_back();
+    return selection.tree.add(op, left, right, value, condition);
+}
+
+int VisitorGenerator::addVariableLeaf(Selection& selection, const std::string& name, const std::string& caller) {
+    std::string location = variableLocation(name, caller);
+    bool inMemory = location.front() == '[';
+
+    int index = addSelectionNode(selection, nullptr, inMemory ? isel::Op::Slot : isel::Op::Var);
+    selection.operands[index] = inMemory ? "qword ptr " + location : location;
+    return index;
+}
+
+int VisitorGenerator::buildSelectionTree(Selection& selection, const NodeExpression& expression) {
+    const NodeExpression& expr = unwrapGrouping(expression);
+
+    if (const auto* primary = std::get_if<NodeExpressionPrimary>(&expr.value)) {
+        if (const auto* value = std::get_if<int>(&primary->value)) {
+            return addSelectionNode(selection, &expr, isel::Op::Const, -1, -1, *value);
+        }
+        if (const auto* name = std::get_if<std::string>(&primary->value)) {
+            return addVariableLeaf(selection, *name, "buildSelectionTree");
+        }
+        throw std::runtime_error("[VisitorGenerator::buildSelectionTree] Unknown primary type");
+    }
+
+    if (const auto* binary = std::get_if<NodeExpressionBinary>(&expr.value)) {
+        int left = buildSelectionTree(selection, *binary->left);
+        int right = buildSelectionTree(selection, *binary->right);
+        switch (binary->op) {
+            case NodeExpressionBinary::BinaryOperator::Add:
+                return addSelectionNode(selection, &expr, isel::Op::Add, left, right);
+            case NodeExpressionBinary::BinaryOperator::Subtract:
+                return addSelectionNode(selection, &expr, isel::Op::Sub, left, right);
+            case NodeExpressionBinary::BinaryOperator::Multiply:
+                return addSelectionNode(selection, &expr, isel::Op::Mul, left, right);
+            case NodeExpressionBinary::BinaryOperator::Divide:
+                return addSelectionNode(selection, &expr, isel::Op::Div, left, right);
+            default:
+                throw std::runtime_error("[VisitorGenerator::buildSelectionTree] Unknown binary operator");
+        }
+    }
+
+    if (const auto* comparison = std::get_if<NodeExpressionComparison>(&expr.value)) {
+        int left = buildSelectionTree(selection, *comparison->left);
+        int right = buildSelectionTree(selection, *comparison->right);
+        return addSelectionNode(selection, &expr, isel::Op::Cmp, left, right, 0, comparisonCondition(comparison->op));
+    }
+
+    // Calls are opaque to the selector and produce their value in rax
+    return addSelectionNode(selection, &expr, isel::Op::Opaque);
+}
+
+isel::Condition VisitorGenerator::emitCondition(const NodeExpression& condition) {
+    // Comparisons set the flags directly, any other value is tested against zero
+    Selection selection;
+    int root = buildSelectionTree(selection, condition);
+    emitSelection(selection, root, isel::NonTerminal::Flags);
+
+    const isel::TreeNode& node = selection.tree.node(root);
+    if (selection.tree.rule(root, isel::NonTerminal::Flags).op == isel::Op::Chain) {
+        return isel::Condition::NotEqual;
+    }
+    return selection.tree.swapped(root, isel::NonTerminal::Flags) ? isel::mirrored(node.condition) : node.condition;
+}
+
+void VisitorGenerator::emitBranchIf(const NodeExpression& condition, const std::string& label) {
+    if (auto value = literalValue(condition)) {
+        if (value.value() != 0) {
+            writeAsm("jmp " + label);
+        }
+        return;
+    }
+    isel::Condition holds = emitCondition(condition);
+    writeAsm("j" + conditionSuffix(holds) + " " + label);
+}
+
+void VisitorGenerator::emitBranchUnless(const NodeExpression& condition, const std::string& label) {
+    if (auto value = literalValue(condition)) {
+        if (value.value() == 0) {
+            writeAsm("jmp " + label);
+        }
+        return;
+    }
+    isel::Condition holds = emitCondition(condition);
+    writeAsm("j" + conditionSuffix(isel::negated(holds)) + " " + label);
+}
+
+void VisitorGenerator::emitSelection(Selection& selection, int root, isel::NonTerminal goal) {
+    selection.tree.label(false, options.optimizeSize);
+    if (selection.tree.cost(root, goal) >= isel::unreachable) {
+        throw std::runtime_error("[VisitorGenerator::emitSelection] No tiling covers the tree");
+    }
+    selection.registerNeeds.assign(selection.tree.size(), 0);
+    emitTile(selection, root, goal);
+}
+
+std::string VisitorGenerator::emitTile(Selection& selection, int index, isel::NonTerminal nt) {
+    using isel::NonTerminal;
+    const isel::TreeNode& node = selection.tree.node(index);
+    const isel::Rule& rule = selection.tree.rule(index, nt);
+
+    if (rule.op == isel::Op::Chain) {
+        std::string operand = emitTile(selection, index, rule.left);
+        for (const auto& line : expandTemplate(rule.asmTemplate, operand, "", "")) {
+            writeAsm(line);
+        }
+        return "rax";
+    }
+
+    // Leaves
+    if (rule.left == NonTerminal::None) {
+        if (node.op == isel::Op::Opaque) {
+            visitExpressionFunctionCall(std::get<NodeExpressionFunctionCall>(selection.sources[index]->value));
+            return "rax";
+        }
+        if (node.op == isel::Op::Const) {
+            return std::to_string(node.value);
+        }
+        return selection.operands[index];
+    }
+
+    bool swapped = selection.tree.swapped(index, nt);
+    int first = swapped ? node.right : node.left;
+    int second = swapped ? node.left : node.right;
+
+    std::string left;
+    std::string right;
+    std::optional<std::string> temporary;
+
+    if (rule.left == NonTerminal::Reg && rule.right == NonTerminal::Reg) {
+        Operands operands = evaluateOperands(selection, first, second);
+        left = operands.left;
+        right = operands.right;
+        temporary = operands.temporary;
+
+        // Two-operand templates want the left operand in rax, cmp takes registers either way
+        if (left != "rax" && node.op != isel::Op::Cmp) {
+            if (isel::isCommutative(node.op)) {
+                std::swap(left, right);
+            } else {
+                writeAsm("mov rcx, rax");
+                writeAsm("mov rax, " + left);
+                left = "rax";
+                right = "rcx";
+            }
+        }
+    } else if (rule.right == NonTerminal::Reg) {
+        right = emitTile(selection, second, NonTerminal::Reg);
+        left = emitTile(selection, first, rule.left);
+    } else {
+        if (rule.left == NonTerminal::Reg) {
+            left = emitTile(selection, first, NonTerminal::Reg);
+        } else {
+            left = emitTile(selection, first, rule.left);
+        }
+        right = emitTile(selection, second, rule.right);
+    }
+
+    // Multiplies and divides by a constant expand to a sequence planned for that constant
+    std::string reduced;
+    std::string_view asmTemplate = rule.asmTemplate;
+    if (isel::isStrengthReduction(rule.constraint)) {
+        reduced = isel::expandedTemplate(rule.constraint, selection.tree.node(second).value);
+        asmTemplate = reduced;
+        (node.op == isel::Op::Mul ? multipliesReduced : divisionsReduced)++;
+    }
+
+    isel::Condition condition = swapped ? isel::mirrored(node.condition) : node.condition;
+    auto lines = expandTemplate(asmTemplate, left, right, conditionSuffix(condition));
+
+    if (temporary.has_value()) {
+        releaseTemporary(temporary.value());
+    }
+
+    // Addressing mode pieces are operands, not instructions
+    if (nt != NonTerminal::Reg && nt != NonTerminal::Stmt && nt != NonTerminal::Flags) {
+        return lines.front();
+    }
+
+    for (const auto& line : lines) {
+        writeAsm(line);
+    }
+    return "rax";
+}
+
+std::vector<std::string> VisitorGenerator::expandTemplate(std::string_view asmTemplate, const std::string& left,
+                                                          const std::string& right, const std::string& condition) {
+    std::vector<std::string> lines(1);
+    for (size_t i = 0; i < asmTemplate.size(); i++) {
+        if (asmTemplate.substr(i, 3) == "{0}") {
+            lines.back() += left;
+            i += 2;
+        } else if (asmTemplate.substr(i, 3) == "{1}") {
+            lines.back() += right;
+            i += 2;
+        } else if (asmTemplate.substr(i, 4) == "{cc}") {
+            lines.back() += condition;
+            i += 3;
+        } else if (asmTemplate[i] == '\n') {
+            lines.emplace_back();
+        } else {
+            lines.back() += asmTemplate[i];
+        }
+    }
+    return lines;
+}
+
+isel::Condition VisitorGenerator::comparisonCondition(NodeExpressionComparison::ComparisonOperator op) {
+    switch (op) {
+        case NodeExpressionComparison::ComparisonOperator::Equal:            return isel::Condition::Equal;
+        case NodeExpressionComparison::ComparisonOperator::NotEqual:         return isel::Condition::NotEqual;
+        case NodeExpressionComparison::ComparisonOperator::LessThan:         return isel::Condition::Less;
+        case NodeExpressionComparison::ComparisonOperator::LessThanEqual:    return isel::Condition::LessEqual;
+        case NodeExpressionComparison::ComparisonOperator::GreaterThan:      return isel::Condition::Greater;
+        case NodeExpressionComparison::ComparisonOperator::GreaterThanEqual: return isel::Condition::GreaterEqual;
+        default:
+            throw std::runtime_error("[VisitorGenerator::comparisonCondition] Unknown comparison operator");
+    }
+}
+
+std::string VisitorGenerator::conditionSuffix(isel::Condition condition) {
+    switch (condition) {
+        case isel::Condition::Equal:        return "e";
+        case isel::Condition::NotEqual:     return "ne";
+        case isel::Condition::Less:         return "l";
+        case isel::Condition::LessEqual:    return "le";
+        case isel::Condition::Greater:      return "g";
+        case isel::Condition::GreaterEqual: return "ge";
+        default:
+            throw std::runtime_error("[VisitorGenerator::conditionSuffix] Unknown condition");
+    }
+}
+
+int VisitorGenerator::registerNeed(Selection& selection, int index) {
+    // A call clobbers every temporary, so it is labelled as needing more than any pool holds
+    static constexpr int callNeed = 1000;
+    using isel::NonTerminal;
+
+    int& need = selection.registerNeeds[index];
+    if (need > 0) {
+        return need;
+    }
+
+    // Sethi-Ullman label of the chosen Reg tiling: operands folded into an instruction
+    // (immediates, variables, stack slots) need no register of their own
+    const isel::TreeNode& node = selection.tree.node(index);
+    const isel::Rule& rule = selection.tree.rule(index, NonTerminal::Reg);
+
+    if (node.op == isel::Op::Opaque) {
+        need = callNeed;
+    } else if (rule.op == isel::Op::Chain || rule.left == NonTerminal::None) {
+        need = 1;
+    } else if (rule.left == NonTerminal::Reg && rule.right == NonTerminal::Reg) {
+        int leftNeed = registerNeed(selection, node.left);
+        int rightNeed = registerNeed(selection, node.right);
+        need = leftNeed == rightNeed ? leftNeed + 1 : std::max(leftNeed, rightNeed);
+    } else if (rule.left == NonTerminal::Reg || rule.right == NonTerminal::Reg) {
+        bool leftIsReg = (rule.left == NonTerminal::Reg) != selection.tree.swapped(index, NonTerminal::Reg);
+        need = registerNeed(selection, leftIsReg ? node.left : node.right);
+    } else {
+        need = 1;
+    }
+    return need;
+}
+
+VisitorGenerator::Operands VisitorGenerator::evaluateOperands(Selection& selection, int left, int right) {
+    // Sethi-Ullman order: the subtree needing more registers goes first, so its result is the
+    // only thing held while the cheaper side runs. Operands of our operators have no side effects
+    // besides calls, which are side-effect free in this language, so the order is unobservable.
+    // On a tie the right side goes first, which leaves the left operand in rax as sub/div/cmp want.
+    bool rightFirst = registerNeed(selection, right) >= registerNeed(selection, left);
+
+    emitTile(selection, rightFirst ? right : left, isel::NonTerminal::Reg);
+
+    // Spill when the tree is deeper than the temporary pool. A push would overwrite the
+    // red zone, so red-zone functions spill into it below their locals instead.
+    auto temporary = acquireTemporary();
+    std::string spillSlot;
+    if (temporary.has_value()) {
+        writeAsm("mov " + temporary.value() + ", rax");
+    } else if (frame == Frame::RedZone) {
+        int offset = frameSize + 8 * ++redZoneSpills;
+        redZoneExhausted = redZoneExhausted || offset > redZoneSize;
+        spillSlot = "qword ptr [rsp - " + std::to_string(offset) + "]";
+        writeAsm("mov " + spillSlot + ", rax");
+    } else {
+        writeAsm("push rax");
+    }
+
+    emitTile(selection, rightFirst ? left : right, isel::NonTerminal::Reg);
+
+    if (temporary.has_value()) {
+        if (rightFirst) {
+            return {"rax", temporary.value(), temporary};
+        }
+        return {temporary.value(), "rax", temporary};
+    }
+
+    std::string reload = spillSlot.empty() ? "pop " : "mov ";
+    std::string source = spillSlot.empty() ? "" : ", " + spillSlot;
+    if (!spillSlot.empty()) {
+        --redZoneSpills;
+    }
+    if (rightFirst) {
+        writeAsm(reload + "rcx" + source);
+    } else {
+        writeAsm("mov rcx, rax");
+        writeAsm(reload + "rax" + source);
+    }
+    return {"rax", "rcx", std::nullopt};
+}
+
+std::optional<std::string> VisitorGenerator::acquireTemporary() {
+    if (freeTemporaries.empty()) {
+        return std::nullopt;
+    }
+    std::string reg = freeTemporaries.front();
+    freeTemporaries.erase(freeTemporaries.begin());
+    busyTemporaries.push_back(reg);
+    clobberedRegisters.insert(reg);
+    return reg;
+}
+
+void VisitorGenerator::releaseTemporary(const std::string& reg) {
+    std::erase(busyTemporaries, reg);
+    freeTemporaries.insert(freeTemporaries.begin(), reg);
+}
+
+void VisitorGenerator::emitEpilogue() {
+    restoreFrame();
+    writeAsm("ret\n");
+}
+
+std::string VisitorGenerator::memoize(const NodeFunction& function, const std::string& body) {
+    const auto& argRegs = RegisterAllocator::getArgumentRegisters();
+    const size_t count = function.parameters.size();
+    const std::string table = function.name + ".memo";
+    const std::string miss = "memo_miss_" + std::to_string(labelCounter++);
+    auto slot = [](size_t index) { return "[r11 + " + std::to_string(8 * index) + "]"; };
+
+    // The arguments are still in their registers: hash them to an entry, return its result when
+    // it holds the same arguments, otherwise run the body and fill the entry in. Recursive calls
+    // go through the lookup as well, so every distinct argument list is computed once.
+    asmOutput.clear();
+    writeAsm(function.name + ":");
+    writeAsm("mov rax, " + argRegs[0]);
+    for (size_t i = 1; i < count; i++) {
+        writeAsm("imul rax, rax, 31");
+        writeAsm("add rax, " + argRegs[i]);
+    }
+    writeAsm("mov r11, 0x9e3779b97f4a7c15");  // 2^64 / golden ratio, spreads the high bits
+    writeAsm("imul rax, r11");
+    writeAsm("shr rax, " + std::to_string(64 - memoTableBits));
+    writeAsm("imul rax, rax, " + std::to_string(8 * (count + 2)));
+    writeAsm("lea r11, [rip + " + table + "]");
+    writeAsm("add r11, rax");
+    writeAsm("cmp qword ptr " + slot(0) + ", 0");
+    writeAsm("je " + miss);
+    for (size_t i = 0; i < count; i++) {
+        writeAsm("cmp " + argRegs[i] + ", " + slot(i + 1));
+        writeAsm("jne " + miss);
+    }
+    writeAsm("mov rax, " + slot(count + 1));
+    writeAsm("ret");
+
+    writeAsm(miss + ":");
+    writeAsm("push r11");
+    for (size_t i = 0; i < count; i++) {
+        writeAsm("push " + argRegs[i]);
+    }
+    writeAsm("call " + function.name + ".body");
+    for (size_t i = count; i-- > 0;) {
+        writeAsm("pop " + argRegs[i]);
+    }
+    writeAsm("pop r11");
+    for (size_t i = 0; i < count; i++) {
+        writeAsm("mov " + slot(i + 1) + ", " + argRegs[i]);
+    }
+    writeAsm("mov " + slot(count + 1) + ", rax");
+    writeAsm("mov qword ptr " + slot(0) + ", 1");
+    writeAsm("ret\n");
+
+    asmOutput += body;
+    writeAsm(".section .bss");
+    writeAsm(".p2align 3");
+    writeAsm(table + ":");
+    writeAsm("    .zero " + std::to_string((8 * (count + 2)) << memoTableBits));
+    writeAsm(".section .text");
+    writeAsm("");
+
+    clobberedRegisters.insert({"rax", "r11"});
+    functionsMemoized++;
+    return asmOutput;
+}
+
+void VisitorGenerator::restoreFrame() {
+    const auto& saved = currentAllocation->calleeSavedUsed;
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        writeAsm("pop " + *it);
+    }
+    if (frame == Frame::BasePointer) {
+        writeAsm("leave");
+    }
+}
+
+std::string VisitorGenerator::optimizeFunction(const std::string& code) {
+    std::vector<std::string> lines;
+    std::istringstream input(code);
+    for (std::string line; std::getline(input, line);) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+
+    // Blocks are laid out first so the peephole sees the final neighbours. It only removes or
+    // retargets register writes the function already made, so the recorded clobbers stay valid.
+    // A second layout drops the labels and blocks the jumps it removed were the last to reach.
+    if (options.optimizationLevel >= 1) {
+        lines = layout.run(peephole.run(layout.run(lines, labelCounter)), labelCounter);
+        if (!options.optimizeSize) {
+            lines = layout.align(lines);
+        }
+    }
+
+    std::string output;
+    for (const auto& line : lines) {
+        output += line + "\n";
+        if (line == "ret") {
+            output += "\n";
+        }
+    }
+    return options.optimizeSize ? shrinkEncodings(output) : output;
+}
+
+std::string VisitorGenerator::shrinkEncodings(const std::string& code) {
+    static const std::unordered_map<std::string, std::string> lowHalves = {
+        {"rax", "eax"}, {"rbx", "ebx"}, {"rcx", "ecx"}, {"rdx", "edx"}, {"rsi", "esi"}, {"rdi", "edi"},
+        {"r8", "r8d"}, {"r9", "r9d"}, {"r10", "r10d"}, {"r11", "r11d"},
+        {"r12", "r12d"}, {"r13", "r13d"}, {"r14", "r14d"}, {"r15", "r15d"},
+    };
+    static const std::regex loadImmediate(R"(mov (r\w+), (\d+))");
+    static const std::regex compareZero(R"(cmp (r\w+), 0)");
+
+    std::vector<std::string> lines;
+    std::istringstream input(code);
+    for (std::string line; std::getline(input, line);) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+
+    auto isLabel = [](const std::string& line) { return line.back() == ':'; };
+
+    // Writing a 32-bit register zero-extends into the full register, and these rewrites
+    // change the flags: no flags are live across a constant load or a comparison result
+    std::vector<std::string> shrunk;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const std::string& line = lines[i];
+        std::smatch match;
+        if (std::regex_match(line, match, loadImmediate) && lowHalves.count(match[1]) && match[2].length() <= 10 &&
+            std::stoll(match[2]) <= INT_MAX) {
+            const std::string& low = lowHalves.at(match[1]);
+            shrunk.push_back(match[2] == "0" ? "xor " + low + ", " + low : "mov " + low + ", " + match[2].str());
+        } else if (std::regex_match(line, match, compareZero) && lowHalves.count(match[1])) {
+            shrunk.push_back("test " + match[1].str() + ", " + match[1].str());
+        } else if (line == "movzx rax, al" && i + 1 < lines.size() && lines[i + 1] == "test rax, rax") {
+            shrunk.push_back("test al, al");  // Only the branch looks at the comparison result
+            i++;
+        } else if (line == "movzx rax, al") {
+            shrunk.push_back("movzx eax, al");
+        } else {
+            shrunk.push_back(line);
+        }
+    }
+
+    // Jumps that land on the next label, unreachable code skipped
+    auto jumpsToNext = [&](size_t i) {
+        const std::string target = shrunk[i].substr(4) + ":";
+        size_t next = i + 1;
+        while (next < shrunk.size() && !isLabel(shrunk[next])) {
+            next++;
+        }
+        for (; next < shrunk.size() && isLabel(shrunk[next]); next++) {
+            if (shrunk[next] == target) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Drop code after an unconditional jump up to the next label, and jumps to the next label
+    std::string output;
+    bool reachable = true;
+    for (size_t i = 0; i < shrunk.size(); i++) {
+        const std::string& line = shrunk[i];
+        if (isLabel(line)) {
+            reachable = true;
+        } else if (!reachable) {
+            continue;
+        } else if (line.starts_with("jmp ") && jumpsToNext(i)) {
+            reachable = false;  // The code skipped on the way to the label is still dead
+            continue;
+        }
+
+        output += line + "\n";
+        if (line.starts_with("jmp ") || line == "ret") {
+            reachable = false;
+            if (line == "ret") {
+                output += "\n";
+            }
+        }
+    }
+    return output;
 }
 
 void VisitorGenerator::setupFunctionParameters(const NodeFunction& function) {
-    const auto& argRegs = getArgRegisters();
+    const auto& argRegs = RegisterAllocator::getArgumentRegisters();
     
-    // Move register parameters to their stack slots
+    // Move register parameters to their allocated registers or stack slots, unused ones stay put
+    std::vector<std::pair<std::string, std::string>> moves;
     for (size_t i = 0; i < function.parameters.size(); i++) {
-        auto offset = currentScope->getOffset(function.parameters[i].name);
-        if (offset.has_value()) {
-            writeAsm("mov [rbp - " + std::to_string(offset.value()) + "], " + argRegs[i]);
+        if (!currentAllocation->parametersUsed[i]) {
+            continue;
         }
+        moves.emplace_back(variableLocation(function.parameters[i].name, "setupFunctionParameters"), argRegs[i]);
     }
+    emitParallelMove(std::move(moves));
 }
 
 void VisitorGenerator::setupFunctionCallArguments(const std::vector<NodeExpression>& arguments) {
-    const auto& argRegs = getArgRegisters();
+    const auto& argRegs = RegisterAllocator::getArgumentRegisters();
     
-    // Put arguments in System V ABI registers
+    // Argument expressions may read locals living in argument registers or contain calls,
+    // so every argument but the last is held in a temporary until all of them are evaluated
+    if (arguments.size() <= freeTemporaries.size() + 1) {
+        std::vector<std::pair<std::string, std::string>> moves;
+        for (size_t i = 0; i < arguments.size(); i++) {
+            visitExpression(arguments[i]);  // Result in rax
+            if (i + 1 < arguments.size()) {
+                std::string temporary = acquireTemporary().value();
+                writeAsm("mov " + temporary + ", rax");
+                moves.emplace_back(argRegs[i], temporary);
+            } else {
+                moves.emplace_back(argRegs[i], "rax");
+            }
+        }
+
+        // Put arguments in System V ABI registers
+        emitParallelMove(moves);
+        for (const auto& [argReg, source] : moves) {
+            if (source != "rax") {
+                releaseTemporary(source);
+            }
+        }
+        return;
+    }
+
+    // Not enough temporaries: fall back to staging the arguments on the stack
     for (size_t i = 0; i < arguments.size(); i++) {
         visitExpression(arguments[i]);  // Result in rax
-        writeAsm("mov " + argRegs[i] + ", rax");
+        if (i + 1 < arguments.size()) {
+            writeAsm("push rax");
+        } else {
+            writeAsm("mov " + argRegs[i] + ", rax");
+        }
+    }
+
+    // Put arguments in System V ABI registers
+    for (size_t i = arguments.size(); i-- > 1;) {
+        writeAsm("pop " + argRegs[i - 1]);
+    }
+}
+
+void VisitorGenerator::emitParallelMove(std::vector<std::pair<std::string, std::string>> moves) {
+    // moves holds (destination, source) pairs that must behave as if performed simultaneously
+    std::erase_if(moves, [](const auto& move) { return move.first == move.second; });
+
+    while (!moves.empty()) {
+        auto ready = std::find_if(moves.begin(), moves.end(), [&moves](const auto& move) {
+            return std::none_of(moves.begin(), moves.end(), [&move](const auto& other) {
+                return other.second == move.first;
+            });
+        });
+
+        if (ready != moves.end()) {
+            writeAsm("mov " + ready->first + ", " + ready->second);
+            moves.erase(ready);
+            continue;
+        }
+
+        // Every remaining destination is still needed as a source: resolve one move of the
+        // cycle with an exchange, the destination's old value now lives in the source register
+        auto [destination, source] = moves.front();
+        writeAsm("xchg " + destination + ", " + source);
+        moves.erase(moves.begin());
+        for (auto& move : moves) {
+            if (move.second == destination) {
+                move.second = source;
+            }
+        }
     }
 }
\ No newline at end of file
@@ -2,20 +2,87 @@
 
 #include "astVisitor.hpp"
 #include "scopeNode.hpp"
+#include "registerAllocator.hpp"
+#include "instructionSelector.hpp"
+#include "peephole.hpp"
+#include "blockLayout.hpp"
+#include "options.hpp"
 
 class VisitorGenerator : public AstVisitor<VisitorGenerator> {
 public:
-    VisitorGenerator(ScopeNode* rootScope);
+    VisitorGenerator(ScopeNode* rootScope, const std::unordered_map<std::string, FunctionAllocation>& allocations,
+                     const codegen::Options& options);
+
+    // Generates one function into its own buffer and records the registers it wrote. A memoized
+    // function is entered through a lookup in a table of earlier results.
+    void generateFunction(const NodeProgram& ast, size_t index, bool memoized = false);
+    const RegisterSet& getClobberedRegisters() const;
+    const peephole::Optimizer& getPeephole() const;
+    const BlockLayout& getLayout() const;
+    int getMultipliesReduced() const;  // Multiplies and divides by constants strength reduced
+    int getDivisionsReduced() const;
+    int getRecursiveCallsLooped() const;  // Calls in tail position turned into jumps
+    int getSiblingCallsJumped() const;
+    int getFunctionsMemoized() const;
+
+    // Emits the entry stub followed by all generated functions in source order
+    std::string assemble(const NodeProgram& ast);
 
-    std::string generate(const NodeProgram& ast);
-    
 private:
     std::string asmOutput;
     ScopeNode* currentScope;
     std::vector<int> childScopeIndexes; // Acts like a stack of indexes for child scopes
     int labelCounter;
+    codegen::Options options;
+    std::string returnLabel;  // Shared epilogue of the current function, size mode only
+    std::string functionName;
+    std::string entryLabel;   // After the prologue, where recursive tail calls jump
+    bool memoizing;
+
+    const std::unordered_map<std::string, FunctionAllocation>& allocations;
+    const FunctionAllocation* currentAllocation;
+    std::unordered_map<std::string, std::string> functionOutputs;
+    RegisterSet clobberedRegisters;
+    peephole::Optimizer peephole;
+    BlockLayout layout;
+
+    // How the current function addresses its stack slots
+    enum class Frame { None, RedZone, BasePointer };
+    static constexpr int redZoneSize = 128;  // System V: bytes below rsp no signal handler touches
+    Frame frame;
+    int frameSize;
+    int redZoneSpills;
+    bool redZoneExhausted;
+
+    int multipliesReduced;
+    int divisionsReduced;
+    int recursiveCallsLooped;
+    int siblingCallsJumped;
+    int functionsMemoized;
+
+    // Memo tables: direct-mapped, an entry is a used flag, the arguments and the result
+    static constexpr int memoTableBits = 10;
+
+    // Expression temporaries: free registers of the current function and those holding a value
+    std::vector<std::string> freeTemporaries;
+    std::vector<std::string> busyTemporaries;
+
+    // An expression or assignment tree handed to the instruction selector
+    struct Selection {
+        isel::SelectionTree tree;
+        std::vector<const NodeExpression*> sources;  // AST node behind each tree node, for calls
+        std::vector<std::string> operands;           // Operand text of variable leaves
+        std::vector<int> registerNeeds;              // Sethi-Ullman labels of the chosen tiling
+    };
+
+    // Where the two operands of a binary operation ended up
+    struct Operands {
+        std::string left;
+        std::string right;
+        std::optional<std::string> temporary;
+    };
     
-    void visitFunction(const NodeFunction& function);
+    void visitFunction(const NodeFunction& function, bool allowRedZone);
     void visitCompoundStatement(const NodeCompoundStatement& compound);
     void visitStatement(const NodeStatement& statement);
     void visitExpression(const NodeExpression& expression);
@@ -26,16 +93,53 @@ private:
     void visitStatementIf(const NodeStatementIf& ifStmt);
     void visitStatementWhile(const NodeStatementWhile& whileStmt);
 
-    void visitExpressionPrimary(const NodeExpressionPrimary& primary);
-    void visitExpressionBinary(const NodeExpressionBinary& binary);
-    void visitExpressionComparison(const NodeExpressionComparison& comparison);
     void visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall);
+    void emitTailCall(const NodeExpressionFunctionCall& funcCall);
+
+    // Helper functions for if-conversion
+
+    static constexpr int ifConversionBudget = 6;  // Speculated work worth less than a likely mispredict
+    bool tryIfConversion(const NodeStatementIf& ifStmt);
+    static const NodeStatementAssignment* singleAssignment(const NodeCompoundStatement& compound);
+    static int speculationCost(const NodeExpression& expression);
+    int addConditionNode(Selection& selection, const NodeExpression& condition, bool negate);
 
     void writeAsm(const std::string& code);
+    std::string variableLocation(const std::string& name, const std::string& caller) const;
+    void emitEpilogue();
+    void restoreFrame();  // Pops the saved registers and the frame, leaving the return address on top
+    std::string memoize(const NodeFunction& function, const std::string& body);
+    std::string optimizeFunction(const std::string& code);
+    static std::string shrinkEncodings(const std::string& code);
+
+    // Helper functions for instruction selection
+
+    static const NodeExpression& unwrapGrouping(const NodeExpression& expression);
+    static std::optional<int> literalValue(const NodeExpression& expression);
+    int addSelectionNode(Selection& selection, const NodeExpression* source, isel::Op op, int left = -1, int right = -1,
+                         int64_t value = 0, isel::Condition condition = isel::Condition::Equal);
+    int addVariableLeaf(Selection& selection, const std::string& name, const std::string& caller);
+    int buildSelectionTree(Selection& selection, const NodeExpression& expression);
+    void emitSelection(Selection& selection, int root, isel::NonTerminal goal);
+    isel::Condition emitCondition(const NodeExpression& condition);  // Sets the flags, returns the code meaning true
+    void emitBranchIf(const NodeExpression& condition, const std::string& label);
+    void emitBranchUnless(const NodeExpression& condition, const std::string& label);
+    std::string emitTile(Selection& selection, int index, isel::NonTerminal nt);
+    static std::vector<std::string> expandTemplate(std::string_view asmTemplate, const std::string& left,
+                                                   const std::string& right, const std::string& condition);
+    static std::string conditionSuffix(isel::Condition condition);
+    static isel::Condition comparisonCondition(NodeExpressionComparison::ComparisonOperator op);
+
+    // Helper functions for expression temporaries
+
+    int registerNeed(Selection& selection, int index);
+    Operands evaluateOperands(Selection& selection, int left, int right);
+    std::optional<std::string> acquireTemporary();
+    void releaseTemporary(const std::string& reg);
     
     // Helper functions for function parameter handling
     
-    static const std::vector<std::string>& getArgRegisters();
     void setupFunctionParameters(const NodeFunction& function);
     void setupFunctionCallArguments(const std::vector<NodeExpression>& arguments);
+    void emitParallelMove(std::vector<std::pair<std::string, std::string>> moves);
 };
@@ -0,0 +1,249 @@
+#include "visitorLiveness.hpp"
+#include <algorithm>
+
+VisitorLiveness::VisitorLiveness(ScopeNode* rootScope)
+    : currentScope(rootScope), childScopeIndexes(), current(nullptr), position(0), loopDepth(0) {}
+
+std::unordered_map<std::string, FunctionLiveness> VisitorLiveness::analyze(const NodeProgram& ast) {
+    std::unordered_map<std::string, FunctionLiveness> result;
+
+    childScopeIndexes.push_back(0);
+    for (const auto& function : ast.functions) {
+        current = &result[function.name];
+        visitFunction(function);
+    }
+    childScopeIndexes.pop_back();
+
+    current = nullptr;
+    return result;
+}
+
+void VisitorLiveness::visitFunction(const NodeFunction& function) {
+    currentScope = &currentScope->getChild(childScopeIndexes.back()++);
+
+    current->scope = currentScope;
+    intervalIndexes.clear();
+    loopRanges.clear();
+    position = 0;
+    loopDepth = 0;
+
+    // Parameters are all defined at the same entry point: they arrive together, so their
+    // intervals overlap even when one of them is never used
+    ++position;
+    for (const auto& param : function.parameters) {
+        VarInfo* variable = currentScope->findVariable(param.name);
+        if (!variable) {
+            throw std::runtime_error("[VisitorLiveness::visitFunction] Parameter '" + param.name + "' not found in scope");
+        }
+        current->parameters.push_back(variable);
+        touch(variable);
+    }
+
+    childScopeIndexes.push_back(0);
+    visitCompoundStatement(function.body);
+    childScopeIndexes.pop_back();
+
+    extendAcrossLoops();
+    markCallCrossings();
+
+    currentScope = currentScope->getParent();
+}
+
+void VisitorLiveness::visitCompoundStatement(const NodeCompoundStatement& compound) {
+    currentScope = &currentScope->getChild(childScopeIndexes.back()++);
+    childScopeIndexes.push_back(0);
+
+    for (const auto& statement : compound.statements) {
+        visitStatement(statement);
+    }
+
+    currentScope = currentScope->getParent();
+    childScopeIndexes.pop_back();
+}
+
+void VisitorLiveness::visitStatement(const NodeStatement& statement) {
+    std::visit([this](const auto& stmt) {
+        using T = std::decay_t<decltype(stmt)>;
+        if constexpr (std::is_same_v<T, NodeStatementEmpty>) {
+            // IGNORE empty statements, they touch no variable
+        } else if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+            visitStatementReturn(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+            visitStatementVarDecl(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+            visitStatementAssignment(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+            visitStatementIf(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+            visitStatementWhile(stmt);
+        } else {
+            throw std::runtime_error("[VisitorLiveness::visitStatement] Unknown statement type");
+        }
+    }, statement.value);
+}
+
+void VisitorLiveness::visitExpression(const NodeExpression& expression) {
+    std::visit([this](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            visitExpressionPrimary(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionBinary>) {
+            visitExpressionBinary(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionComparison>) {
+            visitExpressionComparison(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            visitExpressionFunctionCall(expr);
+        } else {
+            throw std::runtime_error("[VisitorLiveness::visitExpression] Unknown expression type");
+        }
+    }, expression.value);
+}
+
+void VisitorLiveness::visitStatementVarDecl(const NodeStatementVarDecl& varDecl) {
+    if (varDecl.initializer.has_value()) {
+        visitExpressionTree(varDecl.initializer.value());
+    }
+
+    // Declarations without an initializer still store a zero, so they always define
+    ++position;
+    touch(currentScope->findVariable(varDecl.identifier));
+}
+
+void VisitorLiveness::visitStatementReturn(const NodeStatementReturn& returnStmt) {
+    if (returnStmt.expression.has_value()) {
+        visitExpressionTree(returnStmt.expression.value());
+    }
+    ++position;
+}
+
+void VisitorLiveness::visitStatementAssignment(const NodeStatementAssignment& assignment) {
+    visitExpressionTree(assignment.expression);
+
+    ++position;
+    touch(currentScope->findVariableRecursive(assignment.identifier));
+}
+
+void VisitorLiveness::visitStatementIf(const NodeStatementIf& ifStmt) {
+    visitExpressionTree(ifStmt.condition);
+    visitCompoundStatement(*ifStmt.body);
+    if (ifStmt.elseBody.has_value()) {
+        visitCompoundStatement(*ifStmt.elseBody.value());
+    }
+    ++position;
+}
+
+void VisitorLiveness::visitStatementWhile(const NodeStatementWhile& whileStmt) {
+    int loopStart = ++position;
+    ++loopDepth;
+
+    visitExpressionTree(whileStmt.condition);
+    visitCompoundStatement(*whileStmt.body);
+
+    --loopDepth;
+    int loopEnd = ++position;
+    loopRanges.emplace_back(loopStart, loopEnd);
+}
+
+void VisitorLiveness::visitExpressionTree(const NodeExpression& expression) {
+    expressionReads.clear();
+    expressionCalls.clear();
+
+    ++position;
+    visitExpression(expression);
+
+    for (const auto& [variable, enclosing] : expressionReads) {
+        touch(variable);
+    }
+
+    for (const auto* call : expressionCalls) {
+        current->callPositions[call] = position;
+
+        auto& around = current->readsAroundCall[call];
+        for (const auto& [variable, enclosing] : expressionReads) {
+            bool insideArguments = std::find(enclosing.begin(), enclosing.end(), call) != enclosing.end();
+            if (!insideArguments && std::find(around.begin(), around.end(), variable) == around.end()) {
+                around.push_back(variable);
+            }
+        }
+    }
+}
+
+void VisitorLiveness::visitExpressionPrimary(const NodeExpressionPrimary& primary) {
+    if (std::holds_alternative<std::string>(primary.value)) {
+        VarInfo* variable = currentScope->findVariableRecursive(std::get<std::string>(primary.value));
+        if (!variable) {
+            throw std::runtime_error("[VisitorLiveness::visitExpressionPrimary] Unknown identifier: " + std::get<std::string>(primary.value));
+        }
+        expressionReads.emplace_back(variable, enclosingCalls);
+    } else if (std::holds_alternative<std::unique_ptr<NodeExpression>>(primary.value)) {
+        visitExpression(*std::get<std::unique_ptr<NodeExpression>>(primary.value));
+    }
+}
+
+void VisitorLiveness::visitExpressionBinary(const NodeExpressionBinary& binary) {
+    visitExpression(*binary.left);
+    visitExpression(*binary.right);
+}
+
+void VisitorLiveness::visitExpressionComparison(const NodeExpressionComparison& comparison) {
+    visitExpression(*comparison.left);
+    visitExpression(*comparison.right);
+}
+
+void VisitorLiveness::visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall) {
+    // Arguments are always evaluated before the call they belong to
+    enclosingCalls.push_back(&funcCall);
+    for (const auto& arg : funcCall.arguments) {
+        visitExpression(arg);
+    }
+    enclosingCalls.pop_back();
+
+    expressionCalls.push_back(&funcCall);
+}
+
+void VisitorLiveness::touch(VarInfo* variable) {
+    if (!variable) {
+        throw std::runtime_error("[VisitorLiveness::touch] Variable not found in scope");
+    }
+
+    int weight = 1;
+    for (int i = 0; i < loopDepth; i++) {
+        weight *= 10;
+    }
+
+    auto it = intervalIndexes.find(variable);
+    if (it == intervalIndexes.end()) {
+        intervalIndexes[variable] = current->intervals.size();
+        current->intervals.push_back({variable, position, position, weight, false});
+        return;
+    }
+
+    LiveInterval& interval = current->intervals[it->second];
+    interval.end = std::max(interval.end, position);
+    interval.weight += weight;
+}
+
+void VisitorLiveness::extendAcrossLoops() {
+    // A variable defined before a loop and touched inside it is live around the back edge.
+    // Loops are recorded inner first, so outer loops see the already extended ranges.
+    for (const auto& [loopStart, loopEnd] : loopRanges) {
+        for (auto& interval : current->intervals) {
+            if (interval.start < loopStart && interval.end > loopStart && interval.end < loopEnd) {
+                interval.end = loopEnd;
+            }
+        }
+    }
+}
+
+void VisitorLiveness::markCallCrossings() {
+    for (auto& interval : current->intervals) {
+        for (const auto& [call, callPosition] : current->callPositions) {
+            const auto& around = current->readsAroundCall[call];
+            bool readAfterCall = std::find(around.begin(), around.end(), interval.variable) != around.end();
+            if (readAfterCall || (interval.start < callPosition && callPosition < interval.end)) {
+                interval.crossesCall = true;
+                break;
+            }
+        }
+    }
+}
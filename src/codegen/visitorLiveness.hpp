@@ -0,0 +1,69 @@
+#pragma once
+
+#include <unordered_map>
+#include "astVisitor.hpp"
+#include "scopeNode.hpp"
+
+/* Live range of a variable, in program points numbered in statement order. All reads of an
+   expression share one point: the generator is free to reorder operands within an expression. */
+struct LiveInterval {
+    VarInfo* variable;
+    int start;
+    int end;
+    int weight;        // Spill cost: every access counts 10x per enclosing loop
+    bool crossesCall;  // The value must survive at least one call
+};
+
+struct FunctionLiveness {
+    ScopeNode* scope;
+    std::vector<VarInfo*> parameters;
+    std::vector<LiveInterval> intervals;
+    std::unordered_map<const NodeExpressionFunctionCall*, int> callPositions;
+
+    // Variables read by the expression around a call but not inside its arguments:
+    // the generator may evaluate those reads after the call returns
+    std::unordered_map<const NodeExpressionFunctionCall*, std::vector<VarInfo*>> readsAroundCall;
+};
+
+class VisitorLiveness : public AstVisitor<VisitorLiveness> {
+public:
+    VisitorLiveness(ScopeNode* rootScope);
+
+    std::unordered_map<std::string, FunctionLiveness> analyze(const NodeProgram& ast);
+
+private:
+    ScopeNode* currentScope;
+    std::vector<int> childScopeIndexes; // Mirrors the scope walk of VisitorGenerator
+
+    FunctionLiveness* current;
+    std::unordered_map<const VarInfo*, size_t> intervalIndexes;
+    std::vector<std::pair<int, int>> loopRanges;
+    int position;
+    int loopDepth;
+
+    // Reads and calls of the expression tree being visited
+    std::vector<std::pair<VarInfo*, std::vector<const NodeExpressionFunctionCall*>>> expressionReads;
+    std::vector<const NodeExpressionFunctionCall*> expressionCalls;
+    std::vector<const NodeExpressionFunctionCall*> enclosingCalls;
+
+    void visitFunction(const NodeFunction& function);
+    void visitCompoundStatement(const NodeCompoundStatement& compound);
+    void visitStatement(const NodeStatement& statement);
+    void visitExpression(const NodeExpression& expression);
+    void visitExpressionTree(const NodeExpression& expression);
+
+    void visitStatementVarDecl(const NodeStatementVarDecl& varDecl);
+    void visitStatementReturn(const NodeStatementReturn& returnStmt);
+    void visitStatementAssignment(const NodeStatementAssignment& assignment);
+    void visitStatementIf(const NodeStatementIf& ifStmt);
+    void visitStatementWhile(const NodeStatementWhile& whileStmt);
+
+    void visitExpressionPrimary(const NodeExpressionPrimary& primary);
+    void visitExpressionBinary(const NodeExpressionBinary& binary);
+    void visitExpressionComparison(const NodeExpressionComparison& comparison);
+    void visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall);
+
+    void touch(VarInfo* variable);
+    void extendAcrossLoops();
+    void markCallCrossings();
+};
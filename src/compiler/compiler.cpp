@@ -9,8 +9,8 @@
 
 namespace compiler {
 
-Compiler::Compiler(std::string_view source)
-    : source(source) {
+Compiler::Compiler(std::string_view source, const codegen::Options& options)
+    : source(source), options(options) {
     compile();
 }
 
@@ -36,6 +36,25 @@ void Compiler::printAssembly() const {
     }
 }
 
+void Compiler::printStatistics() const {
+    if (codegen) {
+        codegen->getStatistics().print(std::cout);
+    }
+}
+
+void Compiler::printInlineReport() const {
+    if (codegen) {
+        codegen->getStatistics().printRemarks(std::cout, "inliner");
+    }
+}
+
+void Compiler::printIr() const {
+    if (codegen) {
+        codegen->generate();
+        ir::print(codegen->getModule(), std::cout);
+    }
+}
+
 void Compiler::saveAssemblyToFile(const std::string& filename) const {
     if (!codegen) {
         std::cerr << "Error: No code generated to save." << std::endl;
@@ -101,7 +120,7 @@ void Compiler::compile() {
     parser = std::make_unique<parser::Parser>(*lexer);
 
     // Step 3: Generate code from the AST
-    codegen = std::make_unique<codegen::CodeGenerator>(parser->getProgram());
+    codegen = std::make_unique<codegen::CodeGenerator>(parser->getProgram(), options);
 }
 
 } // namespace compiler
\ No newline at end of file
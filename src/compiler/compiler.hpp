@@ -10,7 +10,7 @@ namespace compiler {
 
 class Compiler {
 public:
-    explicit Compiler(std::string_view source);
+    explicit Compiler(std::string_view source, const codegen::Options& options = {});
 
     /* Emit the final assembly code */
     void emitAssembly();
@@ -24,9 +24,13 @@ public:
     void printTokens() const;
     void printAST() const;
     void printAssembly() const;
+    void printStatistics() const;
+    void printInlineReport() const;
+    void printIr() const;
     
 private:
     std::string_view source;
+    codegen::Options options;
     std::unique_ptr<lexer::Lexer> lexer;
     std::unique_ptr<parser::Parser> parser;
     std::unique_ptr<codegen::CodeGenerator> codegen;
@@ -0,0 +1,111 @@
+#include "dominatorTree.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace ir {
+
+DominatorTree::DominatorTree(const Function& function) {
+    size_t count = function.blocks.size();
+    std::vector<int> rpo = function.reversePostorder();
+    if (rpo.size() != count) {
+        throw std::runtime_error("[ir::DominatorTree] Function '" + function.name + "' has unreachable blocks");
+    }
+
+    std::vector<int> rpoIndex(count);
+    for (size_t i = 0; i < rpo.size(); i++) {
+        rpoIndex[rpo[i]] = static_cast<int>(i);
+    }
+
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (rpoIndex[a] > rpoIndex[b]) {
+                a = idoms[a];
+            }
+            while (rpoIndex[b] > rpoIndex[a]) {
+                b = idoms[b];
+            }
+        }
+        return a;
+    };
+
+    idoms.assign(count, -1);
+    idoms[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            int block = rpo[i];
+            int newIdom = -1;
+            for (int predecessor : function.blocks[block].predecessors) {
+                if (idoms[predecessor] >= 0) {
+                    newIdom = newIdom < 0 ? predecessor : intersect(predecessor, newIdom);
+                }
+            }
+            if (newIdom != idoms[block]) {
+                idoms[block] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    idoms[0] = -1;
+
+    childLists.assign(count, {});
+    for (int block : rpo) {
+        if (idoms[block] >= 0) {
+            childLists[idoms[block]].push_back(block);
+        }
+    }
+
+    // A join point is in the frontier of every block between each predecessor and its idom
+    frontiers.assign(count, {});
+    for (size_t block = 0; block < count; block++) {
+        const auto& predecessors = function.blocks[block].predecessors;
+        if (predecessors.size() < 2) {
+            continue;
+        }
+        for (int runner : predecessors) {
+            while (runner >= 0 && runner != idoms[block]) {
+                auto& frontier = frontiers[runner];
+                if (std::find(frontier.begin(), frontier.end(), static_cast<int>(block)) == frontier.end()) {
+                    frontier.push_back(static_cast<int>(block));
+                }
+                runner = idoms[runner];
+            }
+        }
+    }
+
+    entered.assign(count, 0);
+    exited.assign(count, 0);
+    int clock = 0;
+    std::function<void(int)> walk = [&](int block) {
+        entered[block] = clock++;
+        order.push_back(block);
+        for (int child : childLists[block]) {
+            walk(child);
+        }
+        exited[block] = clock++;
+    };
+    walk(0);
+}
+
+int DominatorTree::idom(int block) const {
+    return idoms[block];
+}
+
+const std::vector<int>& DominatorTree::children(int block) const {
+    return childLists[block];
+}
+
+const std::vector<int>& DominatorTree::frontier(int block) const {
+    return frontiers[block];
+}
+
+const std::vector<int>& DominatorTree::preorder() const {
+    return order;
+}
+
+bool DominatorTree::dominates(int a, int b) const {
+    return entered[a] <= entered[b] && exited[b] <= exited[a];
+}
+
+} // namespace ir
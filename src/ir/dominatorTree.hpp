@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include "ir.hpp"
+
+namespace ir {
+
+/* Dominator tree of a function whose blocks are all reachable, computed with the iterative
+   algorithm of Cooper, Harvey and Kennedy over the reverse postorder. */
+class DominatorTree {
+public:
+    explicit DominatorTree(const Function& function);
+
+    int idom(int block) const;  // -1 for the entry
+    const std::vector<int>& children(int block) const;
+    const std::vector<int>& frontier(int block) const;
+    const std::vector<int>& preorder() const;  // Parents before children
+    bool dominates(int a, int b) const;
+
+private:
+    std::vector<int> idoms;
+    std::vector<std::vector<int>> childLists;
+    std::vector<std::vector<int>> frontiers;
+    std::vector<int> order;
+    std::vector<int> entered;  // Preorder and postorder numbers for dominates()
+    std::vector<int> exited;
+};
+
+} // namespace ir
@@ -0,0 +1,217 @@
+#include "ir.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace ir {
+
+bool Instruction::isTerminator() const {
+    return opcode == Opcode::Jump || opcode == Opcode::Branch || opcode == Opcode::Return;
+}
+
+bool Instruction::hasSideEffects() const {
+    return opcode == Opcode::Store || opcode == Opcode::Call || isTerminator();
+}
+
+const Instruction& BasicBlock::terminator() const {
+    if (instructions.empty() || !instructions.back().isTerminator()) {
+        throw std::runtime_error("[ir::BasicBlock::terminator] Block bb" + std::to_string(id) + " is not terminated");
+    }
+    return instructions.back();
+}
+
+int Function::addBlock() {
+    blocks.push_back({static_cast<int>(blocks.size()), {}, {}, {}});
+    return blocks.back().id;
+}
+
+int Function::newValue() {
+    return valueCount++;
+}
+
+void Function::computeEdges() {
+    for (auto& block : blocks) {
+        block.predecessors.clear();
+        block.successors.clear();
+    }
+    for (auto& block : blocks) {
+        for (int target : block.terminator().targets) {
+            block.successors.push_back(target);
+            blocks[target].predecessors.push_back(block.id);
+        }
+    }
+}
+
+int Function::removeUnreachableBlocks() {
+    std::vector<int> newIds(blocks.size(), -1);
+    int kept = 0;
+    for (int id : reversePostorder()) {
+        newIds[id] = 0;
+    }
+    for (auto& id : newIds) {
+        if (id == 0) {
+            id = kept++;
+        }
+    }
+    // Entry keeps id 0 since it comes first in block order
+    int removed = static_cast<int>(blocks.size()) - kept;
+    if (removed == 0) {
+        return 0;
+    }
+
+    std::vector<BasicBlock> survivors;
+    for (auto& block : blocks) {
+        if (newIds[block.id] < 0) {
+            continue;
+        }
+
+        // Phi operands follow the predecessors, drop those of removed predecessors
+        std::vector<bool> keep;
+        for (int predecessor : block.predecessors) {
+            keep.push_back(newIds[predecessor] >= 0);
+        }
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode == Opcode::Phi) {
+                std::vector<int> operands;
+                for (size_t i = 0; i < instruction.operands.size(); i++) {
+                    if (keep[i]) {
+                        operands.push_back(instruction.operands[i]);
+                    }
+                }
+                instruction.operands = std::move(operands);
+            }
+            for (int& target : instruction.targets) {
+                target = newIds[target];
+            }
+        }
+
+        std::vector<int> predecessors;
+        for (int predecessor : block.predecessors) {
+            if (newIds[predecessor] >= 0) {
+                predecessors.push_back(newIds[predecessor]);
+            }
+        }
+        block.predecessors = std::move(predecessors);
+        for (int& successor : block.successors) {
+            successor = newIds[successor];
+        }
+        block.id = newIds[block.id];
+        survivors.push_back(std::move(block));
+    }
+    blocks = std::move(survivors);
+    return removed;
+}
+
+std::vector<int> Function::reversePostorder() const {
+    std::vector<int> order;
+    std::vector<bool> visited(blocks.size(), false);
+
+    std::function<void(int)> visit = [&](int id) {
+        visited[id] = true;
+        for (int target : blocks[id].terminator().targets) {
+            if (!visited[target]) {
+                visit(target);
+            }
+        }
+        order.push_back(id);
+    };
+    if (!blocks.empty()) {
+        visit(0);
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+const char* opcodeName(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Const:  return "const";
+        case Opcode::Param:  return "param";
+        case Opcode::Undef:  return "undef";
+        case Opcode::Load:   return "load";
+        case Opcode::Store:  return "store";
+        case Opcode::Copy:   return "copy";
+        case Opcode::Phi:    return "phi";
+        case Opcode::Add:    return "add";
+        case Opcode::Sub:    return "sub";
+        case Opcode::Mul:    return "mul";
+        case Opcode::Div:    return "div";
+        case Opcode::Cmp:    return "cmp";
+        case Opcode::Call:   return "call";
+        case Opcode::Jump:   return "jmp";
+        case Opcode::Branch: return "br";
+        case Opcode::Return: return "ret";
+        default:
+            throw std::runtime_error("[ir::opcodeName] Unknown opcode");
+    }
+}
+
+static const char* comparisonName(Comparison comparison) {
+    switch (comparison) {
+        case Comparison::Equal:            return "eq";
+        case Comparison::NotEqual:         return "ne";
+        case Comparison::LessThan:         return "lt";
+        case Comparison::LessThanEqual:    return "le";
+        case Comparison::GreaterThan:      return "gt";
+        case Comparison::GreaterThanEqual: return "ge";
+        default:
+            throw std::runtime_error("[ir::comparisonName] Unknown comparison");
+    }
+}
+
+void print(const Function& function, std::ostream& out) {
+    out << "function " << function.name << (function.ssa ? " (ssa)" : "") << ":" << std::endl;
+    for (const auto& block : function.blocks) {
+        out << "  bb" << block.id << ":";
+        if (!block.predecessors.empty()) {
+            out << "  ; preds";
+            for (int predecessor : block.predecessors) {
+                out << " bb" << predecessor;
+            }
+        }
+        out << std::endl;
+
+        for (const auto& instruction : block.instructions) {
+            std::string line = "    ";
+            if (instruction.result >= 0) {
+                line += "%" + std::to_string(instruction.result) + " = ";
+            }
+            line += opcodeName(instruction.opcode);
+            if (instruction.opcode == Opcode::Cmp) {
+                line += std::string(" ") + comparisonName(instruction.comparison);
+            } else if (instruction.opcode == Opcode::Call) {
+                line += " " + instruction.callee;
+            } else if (instruction.opcode == Opcode::Const || instruction.opcode == Opcode::Param) {
+                line += " " + std::to_string(instruction.value);
+            } else if (instruction.opcode == Opcode::Load || instruction.opcode == Opcode::Store) {
+                line += " " + instruction.variable->name;
+            }
+
+            for (size_t i = 0; i < instruction.operands.size(); i++) {
+                line += (i == 0 ? " %" : ", %") + std::to_string(instruction.operands[i]);
+                if (instruction.opcode == Opcode::Phi) {
+                    line += " [bb" + std::to_string(block.predecessors[i]) + "]";
+                }
+            }
+            for (size_t i = 0; i < instruction.targets.size(); i++) {
+                line += (i == 0 && instruction.operands.empty() ? " bb" : ", bb") + std::to_string(instruction.targets[i]);
+            }
+
+            bool namesVariable = instruction.opcode == Opcode::Copy || instruction.opcode == Opcode::Phi ||
+                                 instruction.opcode == Opcode::Param || instruction.opcode == Opcode::Undef;
+            if (namesVariable && instruction.variable) {
+                line += "  ; " + instruction.variable->name;
+            }
+            out << line << std::endl;
+        }
+    }
+}
+
+void print(const Module& module, std::ostream& out) {
+    for (const auto& function : module.functions) {
+        print(function, out);
+        out << std::endl;
+    }
+}
+
+} // namespace ir
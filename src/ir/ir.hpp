@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../parser/nodes.hpp"
+#include "../codegen/scopeNode.hpp"
+
+/* Middle-end IR: functions of basic blocks holding instructions that define numbered values.
+   It is built from the AST with every local in a stack slot (Load/Store of a VarInfo), then
+   mem2reg turns the slots into SSA values (Copy and Phi). Instructions keep pointers to the AST
+   nodes they came from, so analysis results are written back to the AST the backend compiles. */
+namespace ir {
+
+enum class Opcode {
+    Const,   // value
+    Param,   // value = parameter index, variable = the parameter
+    Undef,   // A variable read before any definition reaches it
+    Load,    // Slot read of variable, before mem2reg
+    Store,   // Slot write of variable = operands[0], before mem2reg
+    Copy,    // New SSA version of variable = operands[0], after mem2reg
+    Phi,     // One operand per predecessor, in predecessor order
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Cmp,     // comparison applied to operands[0], operands[1]; 1 or 0
+    Call,    // callee(operands...)
+    Jump,    // to targets[0]
+    Branch,  // to targets[0] when operands[0] is non-zero, else to targets[1]
+    Return,  // operands[0] if the function returns a value on this path
+};
+
+using Comparison = NodeExpressionComparison::ComparisonOperator;
+
+struct Instruction {
+    explicit Instruction(Opcode opcode) : opcode(opcode) {}
+
+    Opcode opcode;
+    int result = -1;  // Value defined, -1 for stores and terminators
+    std::vector<int> operands;
+    std::vector<int> targets;  // Successor blocks of a terminator
+
+    int64_t value = 0;
+    Comparison comparison = Comparison::Equal;
+    std::string callee;
+    VarInfo* variable = nullptr;
+
+    // Where the instruction came from: the expression computing the value, or the statement
+    const NodeExpression* expression = nullptr;
+    const NodeStatement* statement = nullptr;
+
+    bool isTerminator() const;
+    bool hasSideEffects() const;  // Stores, calls and terminators are never removed as unused
+};
+
+struct VariableRead {
+    const NodeExpression* expression;
+    VarInfo* variable;
+    int value;
+};
+
+struct BasicBlock {
+    int id;
+    std::vector<Instruction> instructions;
+    std::vector<int> predecessors;
+    std::vector<int> successors;
+
+    const Instruction& terminator() const;
+};
+
+struct Function {
+    const NodeFunction* source = nullptr;
+    std::string name;
+    std::vector<BasicBlock> blocks;  // blocks[0] is the entry, ids are indexes
+    std::vector<VarInfo*> slots;     // Parameters and locals, in declaration order
+    int valueCount = 0;
+    bool ssa = false;
+
+    // After mem2reg: the value every variable read of the AST sees, its load is gone
+    std::vector<VariableRead> variableReads;
+
+    int addBlock();
+    int newValue();
+    void computeEdges();             // Predecessors and successors from the terminators
+    int removeUnreachableBlocks();   // Renumbers the blocks, returns how many were removed
+    std::vector<int> reversePostorder() const;
+};
+
+struct Module {
+    std::vector<Function> functions;  // Source order
+};
+
+const char* opcodeName(Opcode opcode);
+void print(const Function& function, std::ostream& out);
+void print(const Module& module, std::ostream& out);
+
+} // namespace ir
@@ -0,0 +1,203 @@
+#include "mem2reg.hpp"
+#include "dominatorTree.hpp"
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ir {
+
+Mem2Reg::Mem2Reg() : loadsPromoted(0), phisInserted(0), phisRemoved(0) {}
+
+void Mem2Reg::run(Function& function) {
+    if (function.ssa) {
+        throw std::runtime_error("[ir::Mem2Reg::run] Function '" + function.name + "' is already in SSA form");
+    }
+
+    DominatorTree tree(function);
+    insertPhis(function, tree);
+
+    std::unordered_map<const VarInfo*, std::vector<int>> stacks;
+    std::unordered_map<const VarInfo*, int> undefs;
+    std::vector<Instruction> undefInstructions;
+    std::unordered_map<int, int> replacements;  // Load result -> reaching definition
+
+    auto reaching = [&](VarInfo* variable) {
+        auto& stack = stacks[variable];
+        if (!stack.empty()) {
+            return stack.back();
+        }
+        auto it = undefs.find(variable);
+        if (it == undefs.end()) {
+            Instruction undef{Opcode::Undef};
+            undef.result = function.newValue();
+            undef.variable = variable;
+            undefInstructions.push_back(undef);
+            it = undefs.emplace(variable, undef.result).first;
+        }
+        return it->second;
+    };
+
+    std::function<void(int)> rename = [&](int id) {
+        std::vector<VarInfo*> pushed;
+        BasicBlock& block = function.blocks[id];
+
+        for (auto& instruction : block.instructions) {
+            for (int& operand : instruction.operands) {
+                if (instruction.opcode == Opcode::Phi) {
+                    break;  // Filled in from the predecessors
+                }
+                auto it = replacements.find(operand);
+                if (it != replacements.end()) {
+                    operand = it->second;
+                }
+            }
+
+            if (instruction.opcode == Opcode::Phi) {
+                stacks[instruction.variable].push_back(instruction.result);
+                pushed.push_back(instruction.variable);
+            } else if (instruction.opcode == Opcode::Load) {
+                replacements[instruction.result] = reaching(instruction.variable);
+                function.variableReads.push_back({instruction.expression, instruction.variable, replacements[instruction.result]});
+                loadsPromoted++;
+            } else if (instruction.opcode == Opcode::Store) {
+                instruction.opcode = Opcode::Copy;
+                instruction.result = function.newValue();
+                stacks[instruction.variable].push_back(instruction.result);
+                pushed.push_back(instruction.variable);
+            }
+        }
+
+        for (int successor : block.successors) {
+            const auto& predecessors = function.blocks[successor].predecessors;
+            size_t index = std::find(predecessors.begin(), predecessors.end(), id) - predecessors.begin();
+            for (auto& instruction : function.blocks[successor].instructions) {
+                if (instruction.opcode == Opcode::Phi) {
+                    instruction.operands[index] = reaching(instruction.variable);
+                }
+            }
+        }
+
+        for (int child : tree.children(id)) {
+            rename(child);
+        }
+        for (VarInfo* variable : pushed) {
+            stacks[variable].pop_back();
+        }
+    };
+    rename(0);
+
+    for (auto& block : function.blocks) {
+        std::erase_if(block.instructions, [](const Instruction& instruction) { return instruction.opcode == Opcode::Load; });
+    }
+    auto& entry = function.blocks[0].instructions;
+    entry.insert(entry.begin(), undefInstructions.begin(), undefInstructions.end());
+
+    function.ssa = true;
+    removeDeadPhis(function);
+}
+
+int Mem2Reg::getLoadsPromoted() const {
+    return loadsPromoted;
+}
+
+int Mem2Reg::getPhisInserted() const {
+    return phisInserted;
+}
+
+int Mem2Reg::getPhisRemoved() const {
+    return phisRemoved;
+}
+
+void Mem2Reg::insertPhis(Function& function, const DominatorTree& tree) {
+    std::unordered_map<VarInfo*, std::set<int>> definingBlocks;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block.instructions) {
+            if (instruction.opcode == Opcode::Store) {
+                definingBlocks[instruction.variable].insert(block.id);
+            }
+        }
+    }
+
+    // Slots are visited in declaration order so the phis of a block come out deterministic
+    for (VarInfo* variable : function.slots) {
+        auto it = definingBlocks.find(variable);
+        if (it == definingBlocks.end()) {
+            continue;
+        }
+
+        std::vector<int> worklist(it->second.begin(), it->second.end());
+        std::set<int> hasPhi;
+        while (!worklist.empty()) {
+            int block = worklist.back();
+            worklist.pop_back();
+            for (int join : tree.frontier(block)) {
+                if (!hasPhi.insert(join).second) {
+                    continue;
+                }
+
+                Instruction phi{Opcode::Phi};
+                phi.result = function.newValue();
+                phi.variable = variable;
+                phi.operands.assign(function.blocks[join].predecessors.size(), -1);
+
+                auto& instructions = function.blocks[join].instructions;
+                auto position = std::find_if(instructions.begin(), instructions.end(),
+                                             [](const Instruction& instruction) { return instruction.opcode != Opcode::Phi; });
+                instructions.insert(position, phi);
+                phisInserted++;
+
+                if (!it->second.count(join)) {
+                    worklist.push_back(join);
+                }
+            }
+        }
+    }
+}
+
+void Mem2Reg::removeDeadPhis(Function& function) {
+    // Phis are live when a non-phi instruction reads them, directly or through other phis
+    std::unordered_map<int, const Instruction*> phis;
+    std::vector<int> worklist;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block.instructions) {
+            if (instruction.opcode == Opcode::Phi) {
+                phis[instruction.result] = &instruction;
+            } else {
+                worklist.insert(worklist.end(), instruction.operands.begin(), instruction.operands.end());
+            }
+        }
+    }
+
+    std::set<int> live;
+    while (!worklist.empty()) {
+        int value = worklist.back();
+        worklist.pop_back();
+        auto it = phis.find(value);
+        if (it != phis.end() && live.insert(value).second) {
+            worklist.insert(worklist.end(), it->second->operands.begin(), it->second->operands.end());
+        }
+    }
+
+    // Undefs only dead phis read go as well
+    std::set<int> read;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block.instructions) {
+            if (instruction.opcode != Opcode::Phi || live.count(instruction.result)) {
+                read.insert(instruction.operands.begin(), instruction.operands.end());
+            }
+        }
+    }
+
+    for (auto& block : function.blocks) {
+        phisRemoved += static_cast<int>(std::erase_if(block.instructions, [&](const Instruction& instruction) {
+            return instruction.opcode == Opcode::Phi && !live.count(instruction.result);
+        }));
+        std::erase_if(block.instructions, [&](const Instruction& instruction) {
+            return instruction.opcode == Opcode::Undef && !read.count(instruction.result);
+        });
+    }
+}
+
+} // namespace ir
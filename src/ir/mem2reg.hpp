@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ir.hpp"
+
+namespace ir {
+
+class DominatorTree;
+
+/* Promotes the stack slots of a function to SSA values (Cytron et al.): phis go to the iterated
+   dominance frontier of every block storing a variable, then a walk of the dominator tree
+   renames loads to the reaching definition. Stores become Copy instructions so every
+   definition keeps its statement. Phis nothing reads are removed afterwards. */
+class Mem2Reg {
+public:
+    Mem2Reg();
+
+    void run(Function& function);
+
+    int getLoadsPromoted() const;
+    int getPhisInserted() const;
+    int getPhisRemoved() const;
+
+private:
+    int loadsPromoted;
+    int phisInserted;
+    int phisRemoved;
+
+    void insertPhis(Function& function, const DominatorTree& tree);
+    void removeDeadPhis(Function& function);
+};
+
+} // namespace ir
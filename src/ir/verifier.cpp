@@ -0,0 +1,123 @@
+#include "verifier.hpp"
+#include "dominatorTree.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ir {
+
+namespace {
+
+struct Definition {
+    int block;
+    size_t index;
+};
+
+[[noreturn]] void fail(const Function& function, int block, const std::string& message) {
+    throw std::runtime_error("[ir::Verifier::verify] " + function.name + ", bb" + std::to_string(block) + ": " + message);
+}
+
+} // namespace
+
+void Verifier::verify(const Function& function) {
+    if (function.blocks.empty()) {
+        throw std::runtime_error("[ir::Verifier::verify] " + function.name + ": no entry block");
+    }
+
+    std::unordered_map<int, Definition> definitions;
+    for (const auto& block : function.blocks) {
+        if (block.id != &block - &function.blocks[0]) {
+            fail(function, block.id, "block id does not match its index");
+        }
+        if (block.instructions.empty() || !block.instructions.back().isTerminator()) {
+            fail(function, block.id, "missing terminator");
+        }
+
+        bool phisDone = false;
+        for (size_t i = 0; i < block.instructions.size(); i++) {
+            const Instruction& instruction = block.instructions[i];
+            if (instruction.isTerminator() && i + 1 != block.instructions.size()) {
+                fail(function, block.id, "terminator in the middle of the block");
+            }
+            if (instruction.opcode == Opcode::Phi) {
+                if (phisDone) {
+                    fail(function, block.id, "phi after a non-phi instruction");
+                }
+                if (instruction.operands.size() != block.predecessors.size()) {
+                    fail(function, block.id, "phi %" + std::to_string(instruction.result) + " does not match the predecessors");
+                }
+            } else {
+                phisDone = true;
+            }
+
+            bool slotAccess = instruction.opcode == Opcode::Load || instruction.opcode == Opcode::Store;
+            bool ssaOnly = instruction.opcode == Opcode::Phi || instruction.opcode == Opcode::Copy;
+            if (function.ssa ? slotAccess : ssaOnly) {
+                fail(function, block.id, std::string(opcodeName(instruction.opcode)) + (function.ssa ? " in SSA form" : " before SSA form"));
+            }
+
+            bool definesValue = !instruction.isTerminator() && instruction.opcode != Opcode::Store;
+            if (definesValue != (instruction.result >= 0)) {
+                fail(function, block.id, std::string(opcodeName(instruction.opcode)) + " with a wrong result");
+            }
+            if (instruction.result >= function.valueCount) {
+                fail(function, block.id, "%" + std::to_string(instruction.result) + " beyond the value count");
+            }
+            if (definesValue && !definitions.emplace(instruction.result, Definition{block.id, i}).second) {
+                fail(function, block.id, "%" + std::to_string(instruction.result) + " defined twice");
+            }
+        }
+
+        std::vector<int> successors = block.instructions.back().targets;
+        if (successors != block.successors) {
+            fail(function, block.id, "successors do not match the terminator");
+        }
+        for (int successor : successors) {
+            if (successor < 0 || successor >= static_cast<int>(function.blocks.size())) {
+                fail(function, block.id, "jump to a missing block");
+            }
+            const auto& predecessors = function.blocks[successor].predecessors;
+            if (std::count(predecessors.begin(), predecessors.end(), block.id) != 1) {
+                fail(function, block.id, "not listed once as predecessor of bb" + std::to_string(successor));
+            }
+        }
+        for (int predecessor : block.predecessors) {
+            const auto& predecessorSuccessors = function.blocks[predecessor].successors;
+            if (std::find(predecessorSuccessors.begin(), predecessorSuccessors.end(), block.id) == predecessorSuccessors.end()) {
+                fail(function, block.id, "predecessor bb" + std::to_string(predecessor) + " does not jump here");
+            }
+        }
+    }
+
+    DominatorTree tree(function);
+    for (const auto& block : function.blocks) {
+        for (size_t i = 0; i < block.instructions.size(); i++) {
+            const Instruction& instruction = block.instructions[i];
+            for (size_t k = 0; k < instruction.operands.size(); k++) {
+                int operand = instruction.operands[k];
+                auto it = definitions.find(operand);
+                if (it == definitions.end()) {
+                    fail(function, block.id, "use of undefined %" + std::to_string(operand));
+                }
+
+                // A phi operand is used at the end of its predecessor
+                const Definition& definition = it->second;
+                int useBlock = instruction.opcode == Opcode::Phi ? block.predecessors[k] : block.id;
+                bool dominated = definition.block == useBlock
+                    ? instruction.opcode == Opcode::Phi || definition.index < i
+                    : tree.dominates(definition.block, useBlock);
+                if (!dominated) {
+                    fail(function, block.id, "%" + std::to_string(operand) + " does not dominate its use");
+                }
+            }
+        }
+    }
+}
+
+void Verifier::verify(const Module& module) {
+    for (const auto& function : module.functions) {
+        verify(function);
+    }
+}
+
+} // namespace ir
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ir.hpp"
+
+namespace ir {
+
+/* Structural checks run after every change to the IR; a violation throws with the function
+   and block named. Checked: terminators, CFG edges, phi arity, single definition of every
+   value, and in SSA form that no slot access is left and every definition dominates its uses. */
+class Verifier {
+public:
+    static void verify(const Function& function);
+    static void verify(const Module& module);
+};
+
+} // namespace ir
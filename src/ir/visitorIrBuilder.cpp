@@ -0,0 +1,324 @@
+#include "visitorIrBuilder.hpp"
+#include <stdexcept>
+
+VisitorIrBuilder::VisitorIrBuilder(ScopeNode* rootScope)
+    : currentScope(rootScope), childScopeIndexes(), current(nullptr), currentBlock(0), currentStatement(nullptr),
+      currentExpression(nullptr), result(-1), unreachableBlocksRemoved(0) {}
+
+ir::Module VisitorIrBuilder::build(const NodeProgram& ast) {
+    ir::Module module;
+
+    childScopeIndexes.push_back(0);
+    for (const auto& function : ast.functions) {
+        module.functions.emplace_back();
+        current = &module.functions.back();
+        visitFunction(function);
+    }
+    childScopeIndexes.pop_back();
+
+    current = nullptr;
+    return module;
+}
+
+int VisitorIrBuilder::getUnreachableBlocksRemoved() const {
+    return unreachableBlocksRemoved;
+}
+
+void VisitorIrBuilder::visitFunction(const NodeFunction& function) {
+    currentScope = &currentScope->getChild(childScopeIndexes.back()++);
+
+    current->source = &function;
+    current->name = function.name;
+    currentBlock = current->addBlock();
+    currentStatement = nullptr;
+
+    // Parameters arrive as values and are stored to their slots like any other local
+    for (size_t i = 0; i < function.parameters.size(); i++) {
+        VarInfo* variable = lookup(function.parameters[i].name, "visitFunction");
+        current->slots.push_back(variable);
+
+        ir::Instruction param{ir::Opcode::Param};
+        param.value = static_cast<int64_t>(i);
+        param.variable = variable;
+        int value = emit(param);
+
+        ir::Instruction store{ir::Opcode::Store};
+        store.operands = {value};
+        store.variable = variable;
+        emit(store);
+    }
+
+    childScopeIndexes.push_back(0);
+    visitCompoundStatement(function.body);
+    childScopeIndexes.pop_back();
+
+    // Falling off the end returns whatever rax holds, like the generated code
+    if (!isTerminated()) {
+        emit(ir::Instruction{ir::Opcode::Return});
+    }
+
+    current->computeEdges();
+    unreachableBlocksRemoved += current->removeUnreachableBlocks();
+
+    currentScope = currentScope->getParent();
+}
+
+void VisitorIrBuilder::visitCompoundStatement(const NodeCompoundStatement& compound) {
+    currentScope = &currentScope->getChild(childScopeIndexes.back()++);
+    childScopeIndexes.push_back(0);
+
+    for (const auto& statement : compound.statements) {
+        visitStatement(statement);
+    }
+
+    currentScope = currentScope->getParent();
+    childScopeIndexes.pop_back();
+}
+
+void VisitorIrBuilder::visitStatement(const NodeStatement& statement) {
+    currentStatement = &statement;
+    std::visit([this](const auto& stmt) {
+        using T = std::decay_t<decltype(stmt)>;
+        if constexpr (std::is_same_v<T, NodeStatementEmpty>) {
+            // IGNORE empty statements, they compute nothing
+        } else if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+            visitStatementReturn(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+            visitStatementVarDecl(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+            visitStatementAssignment(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+            visitStatementIf(stmt);
+        } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+            visitStatementWhile(stmt);
+        } else {
+            throw std::runtime_error("[VisitorIrBuilder::visitStatement] Unknown statement type");
+        }
+    }, statement.value);
+}
+
+void VisitorIrBuilder::visitExpression(const NodeExpression& expression) {
+    currentExpression = &expression;
+    std::visit([this](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            visitExpressionPrimary(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionBinary>) {
+            visitExpressionBinary(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionComparison>) {
+            visitExpressionComparison(expr);
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            visitExpressionFunctionCall(expr);
+        } else {
+            throw std::runtime_error("[VisitorIrBuilder::visitExpression] Unknown expression type");
+        }
+    }, expression.value);
+}
+
+void VisitorIrBuilder::visitStatementVarDecl(const NodeStatementVarDecl& varDecl) {
+    const NodeStatement* statement = currentStatement;
+
+    // Every variable of the scope was declared up front by VisitorAnalyzer
+    VarInfo* variable = currentScope->findVariable(varDecl.identifier);
+    if (!variable) {
+        throw std::runtime_error("[VisitorIrBuilder::visitStatementVarDecl] Variable '" + varDecl.identifier + "' not found in scope");
+    }
+    current->slots.push_back(variable);
+
+    if (!varDecl.initializer.has_value() && !varDecl.zeroed) {
+        return;
+    }
+
+    int value;
+    if (varDecl.initializer.has_value()) {
+        visitExpression(varDecl.initializer.value());
+        value = result;
+    } else {
+        ir::Instruction zero{ir::Opcode::Const};
+        zero.statement = statement;
+        value = emit(zero);
+    }
+
+    ir::Instruction store{ir::Opcode::Store};
+    store.operands = {value};
+    store.variable = variable;
+    store.statement = statement;
+    emit(store);
+}
+
+void VisitorIrBuilder::visitStatementReturn(const NodeStatementReturn& returnStmt) {
+    const NodeStatement* statement = currentStatement;
+    ir::Instruction ret{ir::Opcode::Return};
+    if (returnStmt.expression.has_value()) {
+        visitExpression(returnStmt.expression.value());
+        ret.operands = {result};
+    }
+    ret.statement = statement;
+    emit(ret);
+}
+
+void VisitorIrBuilder::visitStatementAssignment(const NodeStatementAssignment& assignment) {
+    const NodeStatement* statement = currentStatement;
+    visitExpression(assignment.expression);
+
+    ir::Instruction store{ir::Opcode::Store};
+    store.operands = {result};
+    store.variable = lookup(assignment.identifier, "visitStatementAssignment");
+    store.statement = statement;
+    emit(store);
+}
+
+void VisitorIrBuilder::visitStatementIf(const NodeStatementIf& ifStmt) {
+    const NodeStatement* statement = currentStatement;
+    visitExpression(ifStmt.condition);
+
+    int thenBlock = current->addBlock();
+    int elseBlock = ifStmt.elseBody.has_value() ? current->addBlock() : -1;
+    int joinBlock = current->addBlock();
+
+    ir::Instruction branch{ir::Opcode::Branch};
+    branch.operands = {result};
+    branch.targets = {thenBlock, elseBlock >= 0 ? elseBlock : joinBlock};
+    branch.statement = statement;
+    emit(branch);
+
+    startBlock(thenBlock);
+    visitCompoundStatement(*ifStmt.body);
+    emitJump(joinBlock);
+
+    if (ifStmt.elseBody.has_value()) {
+        startBlock(elseBlock);
+        visitCompoundStatement(*ifStmt.elseBody.value());
+        emitJump(joinBlock);
+    }
+
+    startBlock(joinBlock);
+}
+
+void VisitorIrBuilder::visitStatementWhile(const NodeStatementWhile& whileStmt) {
+    const NodeStatement* statement = currentStatement;
+    int headerBlock = current->addBlock();
+    int bodyBlock = current->addBlock();
+    int exitBlock = current->addBlock();
+
+    emitJump(headerBlock);
+    startBlock(headerBlock);
+    visitExpression(whileStmt.condition);
+
+    ir::Instruction branch{ir::Opcode::Branch};
+    branch.operands = {result};
+    branch.targets = {bodyBlock, exitBlock};
+    branch.statement = statement;
+    emit(branch);
+
+    startBlock(bodyBlock);
+    visitCompoundStatement(*whileStmt.body);
+    emitJump(headerBlock);
+
+    startBlock(exitBlock);
+}
+
+void VisitorIrBuilder::visitExpressionPrimary(const NodeExpressionPrimary& primary) {
+    const NodeExpression* expression = currentExpression;
+    if (std::holds_alternative<int>(primary.value)) {
+        ir::Instruction constant{ir::Opcode::Const};
+        constant.value = std::get<int>(primary.value);
+        constant.expression = expression;
+        result = emit(constant);
+    } else if (std::holds_alternative<std::string>(primary.value)) {
+        ir::Instruction load{ir::Opcode::Load};
+        load.variable = lookup(std::get<std::string>(primary.value), "visitExpressionPrimary");
+        load.expression = expression;
+        result = emit(load);
+    } else {
+        visitExpression(*std::get<std::unique_ptr<NodeExpression>>(primary.value));
+    }
+}
+
+void VisitorIrBuilder::visitExpressionBinary(const NodeExpressionBinary& binary) {
+    const NodeExpression* expression = currentExpression;
+    visitExpression(*binary.left);
+    int left = result;
+    visitExpression(*binary.right);
+    int right = result;
+
+    ir::Opcode opcode;
+    switch (binary.op) {
+        case NodeExpressionBinary::BinaryOperator::Add:      opcode = ir::Opcode::Add; break;
+        case NodeExpressionBinary::BinaryOperator::Subtract: opcode = ir::Opcode::Sub; break;
+        case NodeExpressionBinary::BinaryOperator::Multiply: opcode = ir::Opcode::Mul; break;
+        case NodeExpressionBinary::BinaryOperator::Divide:   opcode = ir::Opcode::Div; break;
+        default:
+            throw std::runtime_error("[VisitorIrBuilder::visitExpressionBinary] Unknown binary operator");
+    }
+
+    ir::Instruction instruction{opcode};
+    instruction.operands = {left, right};
+    instruction.expression = expression;
+    result = emit(instruction);
+}
+
+void VisitorIrBuilder::visitExpressionComparison(const NodeExpressionComparison& comparison) {
+    const NodeExpression* expression = currentExpression;
+    visitExpression(*comparison.left);
+    int left = result;
+    visitExpression(*comparison.right);
+    int right = result;
+
+    ir::Instruction instruction{ir::Opcode::Cmp};
+    instruction.operands = {left, right};
+    instruction.comparison = comparison.op;
+    instruction.expression = expression;
+    result = emit(instruction);
+}
+
+void VisitorIrBuilder::visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall) {
+    const NodeExpression* expression = currentExpression;
+    ir::Instruction call{ir::Opcode::Call};
+    for (const auto& arg : funcCall.arguments) {
+        visitExpression(arg);
+        call.operands.push_back(result);
+    }
+    call.callee = funcCall.functionName;
+    call.expression = expression;
+    result = emit(call);
+}
+
+int VisitorIrBuilder::emit(ir::Instruction instruction) {
+    // Code after a return goes to a fresh block nothing reaches
+    if (isTerminated()) {
+        startBlock(current->addBlock());
+    }
+
+    bool definesValue = !instruction.isTerminator() && instruction.opcode != ir::Opcode::Store;
+    if (definesValue) {
+        instruction.result = current->newValue();
+    }
+    current->blocks[currentBlock].instructions.push_back(std::move(instruction));
+    return current->blocks[currentBlock].instructions.back().result;
+}
+
+void VisitorIrBuilder::emitJump(int target) {
+    if (!isTerminated()) {
+        ir::Instruction jump{ir::Opcode::Jump};
+        jump.targets = {target};
+        emit(jump);
+    }
+}
+
+void VisitorIrBuilder::startBlock(int block) {
+    currentBlock = block;
+}
+
+bool VisitorIrBuilder::isTerminated() const {
+    const auto& instructions = current->blocks[currentBlock].instructions;
+    return !instructions.empty() && instructions.back().isTerminator();
+}
+
+VarInfo* VisitorIrBuilder::lookup(const std::string& name, const std::string& caller) {
+    VarInfo* variable = currentScope->findVariableRecursive(name);
+    if (!variable) {
+        throw std::runtime_error("[VisitorIrBuilder::" + caller + "] Unknown identifier: " + name);
+    }
+    return variable;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ir.hpp"
+#include "../codegen/astVisitor.hpp"
+
+/* Lowers the AST to IR with every parameter and local in its ScopeNode slot. The scope walk
+   mirrors VisitorLiveness and VisitorGenerator. Code after a return lands in a block without
+   predecessors, which is removed before the function is returned. */
+class VisitorIrBuilder : public AstVisitor<VisitorIrBuilder> {
+public:
+    VisitorIrBuilder(ScopeNode* rootScope);
+
+    ir::Module build(const NodeProgram& ast);
+
+    int getUnreachableBlocksRemoved() const;
+
+private:
+    ScopeNode* currentScope;
+    std::vector<int> childScopeIndexes; // Mirrors the scope walk of VisitorGenerator
+
+    ir::Function* current;
+    int currentBlock;
+    const NodeStatement* currentStatement;
+    const NodeExpression* currentExpression;
+    int result;  // Value of the last visited expression
+    int unreachableBlocksRemoved;
+
+    void visitFunction(const NodeFunction& function);
+    void visitCompoundStatement(const NodeCompoundStatement& compound);
+    void visitStatement(const NodeStatement& statement);
+    void visitExpression(const NodeExpression& expression);
+
+    void visitStatementVarDecl(const NodeStatementVarDecl& varDecl);
+    void visitStatementReturn(const NodeStatementReturn& returnStmt);
+    void visitStatementAssignment(const NodeStatementAssignment& assignment);
+    void visitStatementIf(const NodeStatementIf& ifStmt);
+    void visitStatementWhile(const NodeStatementWhile& whileStmt);
+
+    void visitExpressionPrimary(const NodeExpressionPrimary& primary);
+    void visitExpressionBinary(const NodeExpressionBinary& binary);
+    void visitExpressionComparison(const NodeExpressionComparison& comparison);
+    void visitExpressionFunctionCall(const NodeExpressionFunctionCall& funcCall);
+
+    int emit(ir::Instruction instruction);  // Returns the defined value
+    void emitJump(int target);
+    void startBlock(int block);
+    bool isTerminated() const;
+    VarInfo* lookup(const std::string& name, const std::string& caller);
+};
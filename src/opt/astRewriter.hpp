@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../parser/nodes.hpp"
+
+namespace opt {
+
+/* Offers every expression of the program to rewrite, outermost first. When rewrite replaces
+   an expression (returns true) its old subexpressions are gone and are not visited. */
+template <typename Rewrite>
+class AstRewriter {
+public:
+    explicit AstRewriter(Rewrite rewrite) : rewrite(std::move(rewrite)), rewritten(0) {}
+
+    int run(NodeProgram& program) {
+        for (auto& function : program.functions) {
+            visitCompound(function.body);
+        }
+        return rewritten;
+    }
+
+    void visitCompound(NodeCompoundStatement& compound) {
+        for (auto& statement : compound.statements) {
+            visitStatement(statement);
+        }
+    }
+
+    void visitStatement(NodeStatement& statement) {
+        std::visit([this](auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                if (stmt.expression.has_value()) {
+                    visitExpression(stmt.expression.value());
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                if (stmt.initializer.has_value()) {
+                    visitExpression(stmt.initializer.value());
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                visitExpression(stmt.expression);
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                visitExpression(stmt.condition);
+                visitCompound(*stmt.body);
+                if (stmt.elseBody.has_value()) {
+                    visitCompound(*stmt.elseBody.value());
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                visitExpression(stmt.condition);
+                visitCompound(*stmt.body);
+            }
+        }, statement.value);
+    }
+
+    void visitExpression(NodeExpression& expression) {
+        if (rewrite(expression)) {
+            rewritten++;
+            return;
+        }
+        std::visit([this](auto& expr) {
+            using T = std::decay_t<decltype(expr)>;
+            if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+                if (auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value)) {
+                    visitExpression(**inner);
+                }
+            } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+                for (auto& argument : expr.arguments) {
+                    visitExpression(argument);
+                }
+            } else {
+                visitExpression(*expr.left);
+                visitExpression(*expr.right);
+            }
+        }, expression.value);
+    }
+
+private:
+    Rewrite rewrite;
+    int rewritten;
+};
+
+} // namespace opt
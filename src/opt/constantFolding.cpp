@@ -0,0 +1,330 @@
+#include "constantFolding.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace opt {
+
+namespace {
+
+using BinaryOperator = NodeExpressionBinary::BinaryOperator;
+using ComparisonOperator = NodeExpressionComparison::ComparisonOperator;
+
+bool fitsInt(int64_t value) {
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+// Replaces the expression by one of its own children
+void replaceWith(NodeExpression& expression, std::unique_ptr<NodeExpression>& child) {
+    std::unique_ptr<NodeExpression> keep = std::move(child);
+    expression = std::move(*keep);
+}
+
+} // namespace
+
+std::optional<int64_t> evaluate(BinaryOperator op, int64_t left, int64_t right) {
+    int64_t result;
+    switch (op) {
+        case BinaryOperator::Add:      result = left + right; break;
+        case BinaryOperator::Subtract: result = left - right; break;
+        case BinaryOperator::Multiply: result = left * right; break;
+        case BinaryOperator::Divide:
+            if (right == 0 || (left == INT_MIN && right == -1)) {
+                return std::nullopt;
+            }
+            result = left / right;  // Truncates toward zero like idiv
+            break;
+        default:
+            throw std::runtime_error("[opt::evaluate] Unknown binary operator");
+    }
+    return fitsInt(result) ? std::optional<int64_t>(result) : std::nullopt;
+}
+
+bool compare(ComparisonOperator op, int64_t left, int64_t right) {
+    switch (op) {
+        case ComparisonOperator::Equal:            return left == right;
+        case ComparisonOperator::NotEqual:         return left != right;
+        case ComparisonOperator::LessThan:         return left < right;
+        case ComparisonOperator::LessThanEqual:    return left <= right;
+        case ComparisonOperator::GreaterThan:      return left > right;
+        case ComparisonOperator::GreaterThanEqual: return left >= right;
+        default:
+            throw std::runtime_error("[opt::compare] Unknown comparison operator");
+    }
+}
+
+std::optional<int> constantValue(const NodeExpression& expression) {
+    const auto* primary = std::get_if<NodeExpressionPrimary>(&expression.value);
+    if (!primary) {
+        return std::nullopt;
+    }
+    if (const auto* value = std::get_if<int>(&primary->value)) {
+        return *value;
+    }
+    if (const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&primary->value)) {
+        return constantValue(**inner);
+    }
+    return std::nullopt;
+}
+
+bool hasCalls(const NodeExpression& expression) {
+    return std::visit([](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value);
+            return inner && hasCalls(**inner);
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            return true;
+        } else {
+            return hasCalls(*expr.left) || hasCalls(*expr.right);
+        }
+    }, expression.value);
+}
+
+bool callsAtMost(const NodeExpression& expression, const CallGraph& graph, Purity purity) {
+    return std::visit([&](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value);
+            return !inner || callsAtMost(**inner, graph, purity);
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            if (graph.purityOf(expr.functionName) > purity) {
+                return false;
+            }
+            return std::all_of(expr.arguments.begin(), expr.arguments.end(), [&](const NodeExpression& argument) {
+                return callsAtMost(argument, graph, purity);
+            });
+        } else {
+            return callsAtMost(*expr.left, graph, purity) && callsAtMost(*expr.right, graph, purity);
+        }
+    }, expression.value);
+}
+
+bool sameExpression(const NodeExpression& a, const NodeExpression& b) {
+    if (a.value.index() != b.value.index()) {
+        return false;
+    }
+    return std::visit([&b](const auto& left) {
+        using T = std::decay_t<decltype(left)>;
+        const T& right = std::get<T>(b.value);
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            if (left.value.index() != right.value.index()) {
+                return false;
+            }
+            if (const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&left.value)) {
+                return sameExpression(**inner, *std::get<std::unique_ptr<NodeExpression>>(right.value));
+            }
+            return left.value == right.value;
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            if (left.functionName != right.functionName || left.arguments.size() != right.arguments.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < left.arguments.size(); i++) {
+                if (!sameExpression(left.arguments[i], right.arguments[i])) {
+                    return false;
+                }
+            }
+            return true;
+        } else {
+            return left.op == right.op && sameExpression(*left.left, *right.left) && sameExpression(*left.right, *right.right);
+        }
+    }, a.value);
+}
+
+NodeExpression makeConstant(int64_t value) {
+    if (!fitsInt(value)) {
+        throw std::runtime_error("[opt::makeConstant] " + std::to_string(value) + " does not fit in an int");
+    }
+    return NodeExpression{NodeExpressionPrimary{static_cast<int>(value)}};
+}
+
+ConstantFolding::ConstantFolding() : folded(0), simplified(0), reassociated(0) {}
+
+const char* ConstantFolding::name() const {
+    return "constant-folding";
+}
+
+bool ConstantFolding::run(NodeProgram& program, codegen::AnalysisCache&, codegen::Statistics& statistics) {
+    folded = simplified = reassociated = 0;
+
+    bool changed = false;
+    for (auto& function : program.functions) {
+        changed |= foldCompound(function.body);
+    }
+
+    statistics.add(name(), "expressions-folded", folded);
+    statistics.add(name(), "identities-applied", simplified);
+    statistics.add(name(), "constants-reassociated", reassociated);
+    return changed;
+}
+
+std::set<codegen::Analysis> ConstantFolding::preserved() const {
+    // Declarations and calls are never removed, only expression nodes change
+    return {codegen::Analysis::Scopes, codegen::Analysis::CallGraph};
+}
+
+bool ConstantFolding::foldCompound(NodeCompoundStatement& compound) {
+    bool changed = false;
+    for (auto& statement : compound.statements) {
+        changed |= foldStatement(statement);
+    }
+    return changed;
+}
+
+bool ConstantFolding::foldStatement(NodeStatement& statement) {
+    return std::visit([this](auto& stmt) {
+        using T = std::decay_t<decltype(stmt)>;
+        if constexpr (std::is_same_v<T, NodeStatementEmpty>) {
+            return false;
+        } else if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+            return stmt.expression.has_value() && foldExpression(stmt.expression.value());
+        } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+            return stmt.initializer.has_value() && foldExpression(stmt.initializer.value());
+        } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+            return foldExpression(stmt.expression);
+        } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+            bool changed = foldExpression(stmt.condition);
+            changed |= foldCompound(*stmt.body);
+            if (stmt.elseBody.has_value()) {
+                changed |= foldCompound(*stmt.elseBody.value());
+            }
+            return changed;
+        } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+            bool changed = foldExpression(stmt.condition);
+            return foldCompound(*stmt.body) || changed;
+        } else {
+            throw std::runtime_error("[opt::ConstantFolding::foldStatement] Unknown statement type");
+        }
+    }, statement.value);
+}
+
+bool ConstantFolding::foldExpression(NodeExpression& expression) {
+    if (auto* primary = std::get_if<NodeExpressionPrimary>(&expression.value)) {
+        auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&primary->value);
+        if (!inner) {
+            return false;
+        }
+        // Parentheses only matter to the parser, the tree already holds the grouping
+        foldExpression(**inner);
+        replaceWith(expression, *inner);
+        return true;
+    }
+    if (std::holds_alternative<NodeExpressionBinary>(expression.value)) {
+        return foldBinary(expression);
+    }
+    if (std::holds_alternative<NodeExpressionComparison>(expression.value)) {
+        return foldComparison(expression);
+    }
+
+    bool changed = false;
+    for (auto& argument : std::get<NodeExpressionFunctionCall>(expression.value).arguments) {
+        changed |= foldExpression(argument);
+    }
+    return changed;
+}
+
+bool ConstantFolding::foldBinary(NodeExpression& expression) {
+    auto& binary = std::get<NodeExpressionBinary>(expression.value);
+    bool changed = foldExpression(*binary.left);
+    changed |= foldExpression(*binary.right);
+
+    std::optional<int> left = constantValue(*binary.left);
+    std::optional<int> right = constantValue(*binary.right);
+
+    if (left.has_value() && right.has_value()) {
+        if (auto result = evaluate(binary.op, left.value(), right.value())) {
+            expression = makeConstant(result.value());
+            folded++;
+            return true;
+        }
+        return changed;
+    }
+
+    // x + 0, 0 + x, x - 0, x * 1, 1 * x, x / 1
+    bool rightIdentity = right.has_value() &&
+        ((right.value() == 0 && (binary.op == BinaryOperator::Add || binary.op == BinaryOperator::Subtract)) ||
+         (right.value() == 1 && (binary.op == BinaryOperator::Multiply || binary.op == BinaryOperator::Divide)));
+    bool leftIdentity = left.has_value() &&
+        ((left.value() == 0 && binary.op == BinaryOperator::Add) || (left.value() == 1 && binary.op == BinaryOperator::Multiply));
+    if (rightIdentity || leftIdentity) {
+        replaceWith(expression, rightIdentity ? binary.left : binary.right);
+        simplified++;
+        return true;
+    }
+
+    // x * 0 and x - x, the dropped operand must not make a call
+    bool timesZero = binary.op == BinaryOperator::Multiply &&
+        ((right == 0 && !hasCalls(*binary.left)) || (left == 0 && !hasCalls(*binary.right)));
+    bool selfDifference = binary.op == BinaryOperator::Subtract && !hasCalls(*binary.left) &&
+        sameExpression(*binary.left, *binary.right);
+    if (timesZero || selfDifference) {
+        expression = makeConstant(0);
+        simplified++;
+        return true;
+    }
+
+    return reassociate(expression) || changed;
+}
+
+bool ConstantFolding::reassociate(NodeExpression& expression) {
+    auto& binary = std::get<NodeExpressionBinary>(expression.value);
+
+    // Constants go right in sums and products so nested ones meet: 3 + a becomes a + 3
+    bool commutative = binary.op == BinaryOperator::Add || binary.op == BinaryOperator::Multiply;
+    bool swapped = commutative && constantValue(*binary.left).has_value() && !constantValue(*binary.right).has_value();
+    if (swapped) {
+        std::swap(binary.left, binary.right);
+    }
+
+    std::optional<int> outer = constantValue(*binary.right);
+    auto* inner = std::get_if<NodeExpressionBinary>(&binary.left->value);
+    std::optional<int> innerConstant = inner ? constantValue(*inner->right) : std::nullopt;
+    if (!outer.has_value() || !innerConstant.has_value()) {
+        return swapped;
+    }
+
+    // (a + c1) + c2, (a - c1) + c2, (a + c1) - c2, (a - c1) - c2: one offset, a + c or a - c
+    bool additive = (binary.op == BinaryOperator::Add || binary.op == BinaryOperator::Subtract) &&
+                    (inner->op == BinaryOperator::Add || inner->op == BinaryOperator::Subtract);
+    if (additive) {
+        int64_t offset = (inner->op == BinaryOperator::Add ? 1 : -1) * static_cast<int64_t>(innerConstant.value()) +
+                         (binary.op == BinaryOperator::Add ? 1 : -1) * static_cast<int64_t>(outer.value());
+        if (!fitsInt(offset) || !fitsInt(-offset)) {
+            return swapped;
+        }
+        binary.op = offset < 0 ? BinaryOperator::Subtract : BinaryOperator::Add;
+        *binary.right = makeConstant(offset < 0 ? -offset : offset);
+        replaceWith(*binary.left, inner->left);
+        reassociated++;
+        return true;
+    }
+
+    // (a * c1) * c2
+    if (binary.op == BinaryOperator::Multiply && inner->op == BinaryOperator::Multiply) {
+        int64_t factor = static_cast<int64_t>(innerConstant.value()) * outer.value();
+        if (!fitsInt(factor)) {
+            return swapped;
+        }
+        *binary.right = makeConstant(factor);
+        replaceWith(*binary.left, inner->left);
+        reassociated++;
+        return true;
+    }
+    return swapped;
+}
+
+bool ConstantFolding::foldComparison(NodeExpression& expression) {
+    auto& comparison = std::get<NodeExpressionComparison>(expression.value);
+    bool changed = foldExpression(*comparison.left);
+    changed |= foldExpression(*comparison.right);
+
+    std::optional<int> left = constantValue(*comparison.left);
+    std::optional<int> right = constantValue(*comparison.right);
+    if (left.has_value() && right.has_value()) {
+        expression = makeConstant(compare(comparison.op, left.value(), right.value()) ? 1 : 0);
+        folded++;
+        return true;
+    }
+    return changed;
+}
+
+} // namespace opt
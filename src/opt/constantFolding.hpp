@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Folds constant subexpressions and applies algebraic identities, rewriting the AST in place.
+   The backend computes in 64 bits while the source language has 32-bit ints, so a constant is
+   only folded when every result fits in an int: there both agree. Division by zero and
+   INT_MIN / -1 are left for the program to trap at run time. Identities that drop an operand
+   (x * 0, x - x) only apply when the operand contains no call. */
+class ConstantFolding : public codegen::Pass {
+public:
+    ConstantFolding();
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+    std::set<codegen::Analysis> preserved() const override;
+
+    // Folds one expression tree, returns whether it changed
+    bool foldExpression(NodeExpression& expression);
+
+private:
+    int folded;
+    int simplified;
+    int reassociated;
+
+    bool foldCompound(NodeCompoundStatement& compound);
+    bool foldStatement(NodeStatement& statement);
+    bool foldBinary(NodeExpression& expression);
+    bool foldComparison(NodeExpression& expression);
+    bool reassociate(NodeExpression& expression);
+};
+
+// Helpers shared with the other expression-level passes
+
+// The value of "left op right" when it is defined and fits in an int
+std::optional<int64_t> evaluate(NodeExpressionBinary::BinaryOperator op, int64_t left, int64_t right);
+bool compare(NodeExpressionComparison::ComparisonOperator op, int64_t left, int64_t right);
+std::optional<int> constantValue(const NodeExpression& expression);
+bool hasCalls(const NodeExpression& expression);
+bool callsAtMost(const NodeExpression& expression, const CallGraph& graph, Purity purity);  // Every call is as pure
+bool sameExpression(const NodeExpression& a, const NodeExpression& b);
+NodeExpression makeConstant(int64_t value);
+
+} // namespace opt
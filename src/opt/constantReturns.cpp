@@ -0,0 +1,72 @@
+#include "constantReturns.hpp"
+#include "astRewriter.hpp"
+#include "constantFolding.hpp"
+#include "sccp.hpp"
+
+namespace opt {
+
+const char* ConstantReturnPropagation::name() const {
+    return "constant-return-propagation";
+}
+
+bool ConstantReturnPropagation::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) {
+    const CallGraph& graph = analyses.getCallGraph();
+
+    std::unordered_map<std::string, const ir::Function*> functions;
+    for (const auto& function : analyses.getIr().functions) {
+        functions[function.name] = &function;
+    }
+
+    // Components come callees first: a constant callee is known before its callers are solved
+    std::unordered_map<std::string, int> returns;
+    Sccp solver;
+    for (const auto& component : graph.components) {
+        const std::string& function = component.front();
+        if (graph.purityOf(function) != Purity::Pure) {
+            continue;
+        }
+        std::unordered_map<const NodeExpression*, int> constants;
+        solver.solve(*functions.at(function), constants, returns);
+        if (auto value = solver.returnedConstant()) {
+            returns[function] = value.value();
+        }
+    }
+
+    AstRewriter rewriter([&](NodeExpression& expression) {
+        const auto* call = std::get_if<NodeExpressionFunctionCall>(&expression.value);
+        if (!call) {
+            return false;
+        }
+        auto it = returns.find(call->functionName);
+        if (it == returns.end()) {
+            return false;
+        }
+        // The arguments are not evaluated any more, so they must not do anything either
+        for (const auto& argument : call->arguments) {
+            if (!callsAtMost(argument, graph, Purity::Pure)) {
+                return false;
+            }
+        }
+        expression = makeConstant(it->second);
+        return true;
+    });
+    int replaced = rewriter.run(program);
+
+    std::unordered_map<Purity, int> classes;
+    for (const auto& function : graph.functions) {
+        classes[graph.purityOf(function)]++;
+    }
+    statistics.add(name(), "pure-functions", classes[Purity::Pure]);
+    statistics.add(name(), "read-only-functions", classes[Purity::ReadOnly]);
+    statistics.add(name(), "side-effecting-functions", classes[Purity::SideEffecting]);
+    statistics.add(name(), "constant-functions", static_cast<int>(returns.size()));
+    statistics.add(name(), "calls-replaced", replaced);
+    return replaced > 0;
+}
+
+std::set<codegen::Analysis> ConstantReturnPropagation::preserved() const {
+    // Only calls are replaced, no declaration changes
+    return {codegen::Analysis::Scopes};
+}
+
+} // namespace opt
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Interprocedural constant propagation through return values. Functions are visited callees
+   first; a pure one (see Purity) whose executable returns, by SCCP over its IR, all return the
+   same constant is a constant function, and calls to it count as that constant while its
+   callers are solved. Every call to a constant function whose arguments have no effect is then
+   replaced by the value. Read-only functions are never replaced: their calls may not return. */
+class ConstantReturnPropagation : public codegen::Pass {
+public:
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+    std::set<codegen::Analysis> preserved() const override;
+};
+
+} // namespace opt
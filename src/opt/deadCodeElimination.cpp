@@ -0,0 +1,183 @@
+#include "deadCodeElimination.hpp"
+#include <algorithm>
+#include "constantFolding.hpp"
+
+namespace opt {
+
+namespace {
+
+bool declaresVariables(const NodeCompoundStatement& compound) {
+    return std::any_of(compound.statements.begin(), compound.statements.end(), [](const NodeStatement& statement) {
+        return std::holds_alternative<NodeStatementVarDecl>(statement.value);
+    });
+}
+
+bool compoundNeverFallsThrough(const NodeCompoundStatement& compound) {
+    return std::any_of(compound.statements.begin(), compound.statements.end(), DeadCodeElimination::neverFallsThrough);
+}
+
+// A literal condition, true when non-zero
+std::optional<bool> decided(const NodeExpression& condition) {
+    std::optional<int> value = constantValue(condition);
+    return value.has_value() ? std::optional<bool>(value.value() != 0) : std::nullopt;
+}
+
+NodeStatement makeAlwaysTaken(std::unique_ptr<NodeCompoundStatement> body) {
+    NodeStatementIf ifStmt{makeConstant(1), std::move(body), std::nullopt};
+    return NodeStatement{std::move(ifStmt)};
+}
+
+} // namespace
+
+DeadCodeElimination::DeadCodeElimination() : statementsRemoved(0), branchesFolded(0), loopsRemoved(0) {}
+
+const char* DeadCodeElimination::name() const {
+    return "dead-code-elimination";
+}
+
+bool DeadCodeElimination::run(NodeProgram& program, codegen::AnalysisCache&, codegen::Statistics& statistics) {
+    statementsRemoved = branchesFolded = loopsRemoved = 0;
+
+    bool changed = false;
+    for (auto& function : program.functions) {
+        changed |= eliminateCompound(function.body);
+    }
+
+    statistics.add(name(), "statements-removed", statementsRemoved);
+    statistics.add(name(), "branches-folded", branchesFolded);
+    statistics.add(name(), "loops-removed", loopsRemoved);
+    return changed;
+}
+
+bool DeadCodeElimination::neverFallsThrough(const NodeStatement& statement) {
+    if (std::holds_alternative<NodeStatementReturn>(statement.value)) {
+        return true;
+    }
+    if (const auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+        // The language has no break: a loop on a non-zero literal is only left by a return
+        return decided(whileStmt->condition) == true;
+    }
+    if (const auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+        std::optional<bool> taken = decided(ifStmt->condition);
+        bool thenExits = compoundNeverFallsThrough(*ifStmt->body);
+        bool elseExits = ifStmt->elseBody.has_value() && compoundNeverFallsThrough(*ifStmt->elseBody.value());
+        if (taken.has_value()) {
+            return taken.value() ? thenExits : elseExits;
+        }
+        return thenExits && elseExits;
+    }
+    return false;
+}
+
+bool DeadCodeElimination::eliminateCompound(NodeCompoundStatement& compound) {
+    // Statements stay where they are unless one is replaced: the cached IR points at them
+    bool changed = false;
+    std::optional<std::vector<NodeStatement>> rebuilt;
+    auto& statements = compound.statements;
+
+    for (size_t i = 0; i < statements.size(); i++) {
+        std::optional<std::vector<NodeStatement>> replacement;
+        changed |= eliminateStatement(statements[i], replacement);
+
+        if (replacement.has_value() && !rebuilt.has_value()) {
+            rebuilt.emplace(std::make_move_iterator(statements.begin()), std::make_move_iterator(statements.begin() + i));
+        }
+        if (rebuilt.has_value()) {
+            if (replacement.has_value()) {
+                std::move(replacement->begin(), replacement->end(), std::back_inserter(rebuilt.value()));
+            } else {
+                rebuilt->push_back(std::move(statements[i]));
+            }
+        }
+
+        const auto& kept = rebuilt.has_value() ? rebuilt.value() : statements;
+        size_t end = rebuilt.has_value() ? kept.size() : i + 1;
+        if (end > 0 && neverFallsThrough(kept[end - 1]) && i + 1 < statements.size()) {
+            statementsRemoved += static_cast<int>(statements.size() - i - 1);
+            if (!rebuilt.has_value()) {
+                statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(i) + 1, statements.end());
+            }
+            changed = true;
+            break;
+        }
+    }
+
+    if (rebuilt.has_value()) {
+        statements = std::move(rebuilt.value());
+    }
+    return changed;
+}
+
+bool DeadCodeElimination::eliminateStatement(NodeStatement& statement, std::optional<std::vector<NodeStatement>>& replacement) {
+    if (std::holds_alternative<NodeStatementEmpty>(statement.value)) {
+        statementsRemoved++;
+        replacement.emplace();
+        return true;
+    }
+
+    if (auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+        bool changed = eliminateCompound(*ifStmt->body);
+        if (ifStmt->elseBody.has_value()) {
+            changed |= eliminateCompound(*ifStmt->elseBody.value());
+        }
+        std::vector<NodeStatement> folded;
+        if (foldIf(*ifStmt, folded)) {
+            replacement = std::move(folded);
+            return true;
+        }
+        return changed;
+    }
+
+    if (auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+        if (decided(whileStmt->condition) == false) {
+            loopsRemoved++;
+            replacement.emplace();
+            return true;
+        }
+        return eliminateCompound(*whileStmt->body);
+    }
+
+    return false;
+}
+
+bool DeadCodeElimination::foldIf(NodeStatementIf& ifStmt, std::vector<NodeStatement>& output) {
+    std::optional<bool> taken = decided(ifStmt.condition);
+    if (!taken.has_value()) {
+        // Nothing to branch around: only the condition's calls would remain
+        bool empty = ifStmt.body->statements.empty() &&
+                     (!ifStmt.elseBody.has_value() || ifStmt.elseBody.value()->statements.empty());
+        if (empty && !hasCalls(ifStmt.condition)) {
+            branchesFolded++;
+            return true;
+        }
+        return false;
+    }
+
+    std::unique_ptr<NodeCompoundStatement> kept;
+    if (taken.value()) {
+        kept = std::move(ifStmt.body);
+    } else if (ifStmt.elseBody.has_value()) {
+        kept = std::move(ifStmt.elseBody.value());
+    }
+
+    // if (1) without an else is already as folded as a scope allows
+    if (taken.value() && !ifStmt.elseBody.has_value() && kept && declaresVariables(*kept)) {
+        ifStmt.body = std::move(kept);
+        return false;
+    }
+
+    branchesFolded++;
+    if (!kept) {
+        return true;
+    }
+    if (declaresVariables(*kept)) {
+        output.push_back(makeAlwaysTaken(std::move(kept)));
+        return true;
+    }
+    for (auto& inner : kept->statements) {
+        output.push_back(std::move(inner));
+    }
+    return true;
+}
+
+} // namespace opt
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Removes code that can never run, rewriting the AST before anything is generated for it:
+   statements after one that never falls through (return, while with a non-zero literal
+   condition, if/else leaving on both sides), branches of if statements on a literal and
+   while (0) loops. The taken side of a decided if is spliced into the enclosing block when it
+   declares nothing, otherwise it stays an if (1) so its scope is kept. Calls only disappear
+   with the unreachable code around them. */
+class DeadCodeElimination : public codegen::Pass {
+public:
+    DeadCodeElimination();
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+
+    static bool neverFallsThrough(const NodeStatement& statement);
+
+private:
+    int statementsRemoved;
+    int branchesFolded;
+    int loopsRemoved;
+
+    bool eliminateCompound(NodeCompoundStatement& compound);
+    bool eliminateStatement(NodeStatement& statement, std::optional<std::vector<NodeStatement>>& replacement);
+    bool foldIf(NodeStatementIf& ifStmt, std::vector<NodeStatement>& output);
+};
+
+} // namespace opt
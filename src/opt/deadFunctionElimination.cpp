@@ -0,0 +1,48 @@
+#include "deadFunctionElimination.hpp"
+#include <algorithm>
+#include "inliner.hpp"
+
+namespace opt {
+
+const char* DeadFunctionElimination::name() const {
+    return "dead-function-elimination";
+}
+
+bool DeadFunctionElimination::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) {
+    const CallGraph& graph = analyses.getCallGraph();
+
+    // Without an entry the analyzer reports the error, nothing is removed before that
+    std::vector<std::string> worklist;
+    std::copy_if(graph.functions.begin(), graph.functions.end(), std::back_inserter(worklist), CallGraph::isExported);
+    if (worklist.empty()) {
+        return false;
+    }
+
+    std::unordered_set<std::string> reachable(worklist.begin(), worklist.end());
+    while (!worklist.empty()) {
+        std::string function = worklist.back();
+        worklist.pop_back();
+        for (const auto& callee : graph.callees.at(function)) {
+            if (graph.isDefined(callee) && reachable.insert(callee).second) {
+                worklist.push_back(callee);
+            }
+        }
+    }
+
+    int removed = 0;
+    int nodesRemoved = 0;
+    std::erase_if(program.functions, [&](const NodeFunction& function) {
+        if (reachable.count(function.name)) {
+            return false;
+        }
+        removed++;
+        nodesRemoved += Inliner::bodySize(function.body);
+        return true;
+    });
+
+    statistics.add(name(), "functions-removed", removed);
+    statistics.add(name(), "ast-nodes-removed", nodesRemoved);
+    return removed > 0;
+}
+
+} // namespace opt
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Whole-program dead function elimination: only functions the call graph reaches from main,
+   the one entry _start calls, are kept. Running first, it spares the unreachable functions of
+   the source every analysis and the code generator; running last, it drops what the other
+   passes left unreachable, such as functions inlined into all their callers or replaced by
+   their clones. Removed functions never reach the code generator, so their size is reported
+   in AST nodes, the unit of the inliner's growth, rather than in bytes. */
+class DeadFunctionElimination : public codegen::Pass {
+public:
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+};
+
+} // namespace opt
@@ -0,0 +1,235 @@
+#include "deadStoreElimination.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include "constantFolding.hpp"
+
+namespace opt {
+
+using ir::Opcode;
+
+namespace {
+
+std::vector<bool> liveValues(const ir::Function& function) {
+    std::vector<const ir::Instruction*> definitions(function.valueCount, nullptr);
+    std::vector<int> worklist;
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block.instructions) {
+            if (instruction.result >= 0) {
+                definitions[instruction.result] = &instruction;
+            }
+            bool root = instruction.opcode == Opcode::Return || instruction.opcode == Opcode::Branch ||
+                        instruction.opcode == Opcode::Call;
+            if (root) {
+                worklist.insert(worklist.end(), instruction.operands.begin(), instruction.operands.end());
+            }
+        }
+    }
+
+    std::vector<bool> live(function.valueCount, false);
+    while (!worklist.empty()) {
+        int value = worklist.back();
+        worklist.pop_back();
+        if (live[value]) {
+            continue;
+        }
+        live[value] = true;
+        const auto& operands = definitions[value]->operands;
+        worklist.insert(worklist.end(), operands.begin(), operands.end());
+    }
+    return live;
+}
+
+// The expression a store writes, null for a declaration without initializer
+const NodeExpression* storedExpression(const NodeStatement& statement) {
+    if (const auto* assignment = std::get_if<NodeStatementAssignment>(&statement.value)) {
+        return &assignment->expression;
+    }
+    const auto& varDecl = std::get<NodeStatementVarDecl>(statement.value);
+    return varDecl.initializer.has_value() ? &varDecl.initializer.value() : nullptr;
+}
+
+/* Finds the variables still read once the dead stores are gone: reads inside a removed
+   expression do not count. Reads the IR never saw (unreachable code) count by name. */
+class ReadCollector {
+public:
+    ReadCollector(const std::unordered_map<const NodeExpression*, VarInfo*>& readVariables,
+                  const std::unordered_set<const NodeExpression*>& removedExpressions)
+        : readVariables(readVariables), removedExpressions(removedExpressions) {}
+
+    std::unordered_set<const VarInfo*> variables;
+    std::set<std::string> names;
+
+    void visitCompound(const NodeCompoundStatement& compound) {
+        for (const auto& statement : compound.statements) {
+            std::visit([this](const auto& stmt) {
+                using T = std::decay_t<decltype(stmt)>;
+                if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                    if (stmt.expression.has_value()) {
+                        visitExpression(stmt.expression.value());
+                    }
+                } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                    if (stmt.initializer.has_value()) {
+                        visitExpression(stmt.initializer.value());
+                    }
+                } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                    visitExpression(stmt.expression);
+                } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                    visitExpression(stmt.condition);
+                    visitCompound(*stmt.body);
+                    if (stmt.elseBody.has_value()) {
+                        visitCompound(*stmt.elseBody.value());
+                    }
+                } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                    visitExpression(stmt.condition);
+                    visitCompound(*stmt.body);
+                }
+            }, statement.value);
+        }
+    }
+
+    void visitExpression(const NodeExpression& expression) {
+        if (removedExpressions.count(&expression)) {
+            return;
+        }
+        std::visit([this, &expression](const auto& expr) {
+            using T = std::decay_t<decltype(expr)>;
+            if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+                if (const auto* name = std::get_if<std::string>(&expr.value)) {
+                    auto it = readVariables.find(&expression);
+                    if (it != readVariables.end()) {
+                        variables.insert(it->second);
+                    } else {
+                        names.insert(*name);
+                    }
+                } else if (const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value)) {
+                    visitExpression(**inner);
+                }
+            } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+                for (const auto& argument : expr.arguments) {
+                    visitExpression(argument);
+                }
+            } else {
+                visitExpression(*expr.left);
+                visitExpression(*expr.right);
+            }
+        }, expression.value);
+    }
+
+private:
+    const std::unordered_map<const NodeExpression*, VarInfo*>& readVariables;
+    const std::unordered_set<const NodeExpression*>& removedExpressions;
+};
+
+} // namespace
+
+DeadStoreElimination::DeadStoreElimination() : storesRemoved(0), initializersRemoved(0), variablesRemoved(0) {}
+
+const char* DeadStoreElimination::name() const {
+    return "dead-store-elimination";
+}
+
+bool DeadStoreElimination::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) {
+    storesRemoved = initializersRemoved = variablesRemoved = 0;
+    removedStatements.clear();
+    clearedDeclarations.clear();
+
+    // Decide everything on the IR first: removing statements moves the nodes it points to
+    for (const auto& function : analyses.getIr().functions) {
+        findDeadStores(function);
+    }
+
+    bool changed = false;
+    for (auto& function : program.functions) {
+        changed |= removeCompound(function.body);
+    }
+
+    statistics.add(name(), "stores-removed", storesRemoved);
+    statistics.add(name(), "initializers-removed", initializersRemoved);
+    statistics.add(name(), "variables-removed", variablesRemoved);
+    return changed;
+}
+
+void DeadStoreElimination::findDeadStores(const ir::Function& function) {
+    std::vector<bool> live = liveValues(function);
+
+    // Stores per variable, and which of them can go
+    std::unordered_map<const VarInfo*, std::vector<const NodeStatement*>> stores;
+    std::unordered_set<const VarInfo*> keptStores;
+    std::unordered_set<const NodeStatement*> deadStores;
+    std::unordered_set<const NodeExpression*> removedExpressions;
+
+    for (const auto& block : function.blocks) {
+        for (const auto& instruction : block.instructions) {
+            if (instruction.opcode != Opcode::Copy || !instruction.statement) {
+                continue;  // Parameters are defined by the caller, never removed
+            }
+            const NodeStatement* statement = instruction.statement;
+            const NodeExpression* expression = storedExpression(*statement);
+            stores[instruction.variable].push_back(statement);
+
+            if (live[instruction.result] || (expression && hasCalls(*expression))) {
+                keptStores.insert(instruction.variable);
+                continue;
+            }
+            deadStores.insert(statement);
+            if (expression) {
+                removedExpressions.insert(expression);
+            }
+        }
+    }
+
+    std::unordered_map<const NodeExpression*, VarInfo*> readVariables;
+    for (const auto& read : function.variableReads) {
+        readVariables[read.expression] = read.variable;
+    }
+    ReadCollector reads(readVariables, removedExpressions);
+    reads.visitCompound(function.source->body);
+
+    for (const auto& [variable, statements] : stores) {
+        bool unused = !keptStores.count(variable) && !reads.variables.count(variable) && !reads.names.count(variable->name);
+        for (const NodeStatement* statement : statements) {
+            if (!deadStores.count(statement)) {
+                continue;
+            }
+            bool declaration = std::holds_alternative<NodeStatementVarDecl>(statement->value);
+            if (!declaration) {
+                removedStatements.insert(statement);
+                storesRemoved++;
+            } else if (unused) {
+                removedStatements.insert(statement);
+                variablesRemoved++;
+            } else {
+                clearedDeclarations.insert(statement);
+                initializersRemoved++;
+            }
+        }
+    }
+}
+
+bool DeadStoreElimination::removeCompound(NodeCompoundStatement& compound) {
+    bool changed = false;
+
+    // Nested blocks first: nodes of this block move once its statements are erased
+    for (auto& statement : compound.statements) {
+        if (auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+            changed |= removeCompound(*ifStmt->body);
+            if (ifStmt->elseBody.has_value()) {
+                changed |= removeCompound(*ifStmt->elseBody.value());
+            }
+        } else if (auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            changed |= removeCompound(*whileStmt->body);
+        } else if (clearedDeclarations.count(&statement)) {
+            auto& varDecl = std::get<NodeStatementVarDecl>(statement.value);
+            varDecl.initializer.reset();
+            varDecl.zeroed = false;
+            changed = true;
+        }
+    }
+
+    size_t erased = std::erase_if(compound.statements, [this](const NodeStatement& statement) {
+        return removedStatements.count(&statement) > 0;
+    });
+    return changed || erased > 0;
+}
+
+} // namespace opt
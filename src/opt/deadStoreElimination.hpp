@@ -0,0 +1,34 @@
+#pragma once
+
+#include <set>
+#include <unordered_set>
+#include "../codegen/passManager.hpp"
+#include "../ir/ir.hpp"
+
+namespace opt {
+
+/* Removes stores no read can observe, found on the SSA IR: a value is live when a return, a
+   branch or a call uses it, or a live value is computed from it; every other Copy is a dead
+   store. Assignments storing a dead value are removed and so are dead initializers, including
+   the implicit zero of "int x;". A variable none of whose stores is live and that is no longer
+   read anywhere loses its declaration too. Stores whose expression calls a function stay. */
+class DeadStoreElimination : public codegen::Pass {
+public:
+    DeadStoreElimination();
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+
+private:
+    std::unordered_set<const NodeStatement*> removedStatements;  // Assignments and whole declarations
+    std::unordered_set<const NodeStatement*> clearedDeclarations;
+
+    int storesRemoved;
+    int initializersRemoved;
+    int variablesRemoved;
+
+    void findDeadStores(const ir::Function& function);
+    bool removeCompound(NodeCompoundStatement& compound);
+};
+
+} // namespace opt
@@ -0,0 +1,549 @@
+#include "inliner.hpp"
+#include <algorithm>
+#include <functional>
+#include "constantFolding.hpp"
+#include "deadCodeElimination.hpp"
+
+namespace opt {
+
+namespace {
+
+constexpr int callBenefit = 5;       // call, ret, prologue and epilogue
+constexpr int argumentBenefit = 2;   // Moving an argument to its register and back
+constexpr int constantBenefit = 8;   // A constant argument folds into the body
+constexpr int onlyCallBenefit = 20;  // The callee itself may go away
+
+int expressionSize(const NodeExpression& expression) {
+    return 1 + std::visit([](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value);
+            return inner ? expressionSize(**inner) : 0;
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            int size = 0;
+            for (const auto& argument : expr.arguments) {
+                size += expressionSize(argument);
+            }
+            return size;
+        } else {
+            return expressionSize(*expr.left) + expressionSize(*expr.right);
+        }
+    }, expression.value);
+}
+
+int compoundSize(const NodeCompoundStatement& compound) {
+    int size = 0;
+    for (const auto& statement : compound.statements) {
+        size += 1 + std::visit([](const auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                return stmt.expression.has_value() ? expressionSize(stmt.expression.value()) : 0;
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                return stmt.initializer.has_value() ? expressionSize(stmt.initializer.value()) : 0;
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                return expressionSize(stmt.expression);
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                int size = expressionSize(stmt.condition) + compoundSize(*stmt.body);
+                return stmt.elseBody.has_value() ? size + compoundSize(*stmt.elseBody.value()) : size;
+            } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                return expressionSize(stmt.condition) + compoundSize(*stmt.body);
+            } else {
+                return 0;
+            }
+        }, statement.value);
+    }
+    return size;
+}
+
+void collectCalls(const NodeExpression& expression, std::unordered_map<std::string, int>& callSites);
+
+void collectCalls(const NodeCompoundStatement& compound, std::unordered_map<std::string, int>& callSites) {
+    for (const auto& statement : compound.statements) {
+        std::visit([&](const auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                if (stmt.expression.has_value()) {
+                    collectCalls(stmt.expression.value(), callSites);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                if (stmt.initializer.has_value()) {
+                    collectCalls(stmt.initializer.value(), callSites);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                collectCalls(stmt.expression, callSites);
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                collectCalls(stmt.condition, callSites);
+                collectCalls(*stmt.body, callSites);
+                if (stmt.elseBody.has_value()) {
+                    collectCalls(*stmt.elseBody.value(), callSites);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                collectCalls(stmt.condition, callSites);
+                collectCalls(*stmt.body, callSites);
+            }
+        }, statement.value);
+    }
+}
+
+void collectCalls(const NodeExpression& expression, std::unordered_map<std::string, int>& callSites) {
+    std::visit([&](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            if (const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value)) {
+                collectCalls(**inner, callSites);
+            }
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            callSites[expr.functionName]++;
+            for (const auto& argument : expr.arguments) {
+                collectCalls(argument, callSites);
+            }
+        } else {
+            collectCalls(*expr.left, callSites);
+            collectCalls(*expr.right, callSites);
+        }
+    }, expression.value);
+}
+
+void collectDeclarations(const NodeCompoundStatement& compound, std::unordered_set<std::string>& names) {
+    for (const auto& statement : compound.statements) {
+        if (const auto* varDecl = std::get_if<NodeStatementVarDecl>(&statement.value)) {
+            names.insert(varDecl->identifier);
+        } else if (const auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+            collectDeclarations(*ifStmt->body, names);
+            if (ifStmt->elseBody.has_value()) {
+                collectDeclarations(*ifStmt->elseBody.value(), names);
+            }
+        } else if (const auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            collectDeclarations(*whileStmt->body, names);
+        }
+    }
+}
+
+bool containsReturn(const NodeCompoundStatement& compound) {
+    return std::any_of(compound.statements.begin(), compound.statements.end(), [](const NodeStatement& statement) {
+        if (std::holds_alternative<NodeStatementReturn>(statement.value)) {
+            return true;
+        }
+        if (const auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+            return containsReturn(*ifStmt->body) || (ifStmt->elseBody.has_value() && containsReturn(*ifStmt->elseBody.value()));
+        }
+        if (const auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            return containsReturn(*whileStmt->body);
+        }
+        return false;
+    });
+}
+
+bool alwaysExits(const NodeCompoundStatement& compound) {
+    return std::any_of(compound.statements.begin(), compound.statements.end(), DeadCodeElimination::neverFallsThrough);
+}
+
+/* Turns every return of an inlined body into an assignment to result, after which control
+   must reach the end of the body. The statements after an if whose branches that return
+   always do move into the branch that falls through; fails on a return inside a loop or in
+   a branch that can also fall through, which would need a flag. */
+bool lowerReturns(std::vector<NodeStatement>& statements, const std::string& result) {
+    for (size_t i = 0; i < statements.size(); i++) {
+        NodeStatement& statement = statements[i];
+
+        if (auto* returnStmt = std::get_if<NodeStatementReturn>(&statement.value)) {
+            if (returnStmt->expression.has_value()) {
+                NodeStatementAssignment assignment{result, std::move(returnStmt->expression.value())};
+                statement = NodeStatement{std::move(assignment)};
+            } else {
+                statement = NodeStatement{NodeStatementEmpty{}};
+            }
+            statements.erase(statements.begin() + i + 1, statements.end());
+            return true;
+        }
+
+        if (auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            if (containsReturn(*whileStmt->body)) {
+                return false;
+            }
+            continue;
+        }
+
+        auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value);
+        if (!ifStmt) {
+            continue;
+        }
+        bool thenReturns = containsReturn(*ifStmt->body);
+        bool elseReturns = ifStmt->elseBody.has_value() && containsReturn(*ifStmt->elseBody.value());
+        if (!thenReturns && !elseReturns) {
+            continue;
+        }
+        bool thenExits = alwaysExits(*ifStmt->body);
+        bool elseExits = ifStmt->elseBody.has_value() && alwaysExits(*ifStmt->elseBody.value());
+        if ((thenReturns && !thenExits) || (elseReturns && !elseExits)) {
+            return false;
+        }
+
+        std::vector<NodeStatement> rest(std::make_move_iterator(statements.begin() + i + 1),
+                                        std::make_move_iterator(statements.end()));
+        statements.erase(statements.begin() + i + 1, statements.end());
+        if (!ifStmt->elseBody.has_value()) {
+            ifStmt->elseBody = std::make_unique<NodeCompoundStatement>();
+        }
+        auto& fallsThrough = thenExits ? ifStmt->elseBody.value()->statements : ifStmt->body->statements;
+        if (!thenExits || !elseExits) {
+            std::move(rest.begin(), rest.end(), std::back_inserter(fallsThrough));
+        }
+        return lowerReturns(ifStmt->body->statements, result) && lowerReturns(ifStmt->elseBody.value()->statements, result);
+    }
+    return true;
+}
+
+/* Copies a function body, giving every parameter and local a fresh name. Like the analyzer,
+   a declaration is in scope from where it appears to the end of its block, so a use before
+   an inner declaration still names the outer variable. */
+class Renamer {
+public:
+    Renamer(std::string prefix, std::unordered_set<std::string>& names) : prefix(std::move(prefix)), names(names) {
+        scopes.emplace_back();
+    }
+
+    std::string declare(const std::string& name) {
+        std::string fresh = prefix + name;
+        for (int suffix = 1; names.count(fresh); suffix++) {
+            fresh = prefix + name + "." + std::to_string(suffix);
+        }
+        names.insert(fresh);
+        scopes.back()[name] = fresh;
+        return fresh;
+    }
+
+    std::vector<NodeStatement> cloneBody(const NodeCompoundStatement& compound) {
+        scopes.emplace_back();
+        std::vector<NodeStatement> statements;
+        for (const auto& statement : compound.statements) {
+            statements.push_back(cloneStatement(statement));
+        }
+        scopes.pop_back();
+        return statements;
+    }
+
+private:
+    std::string prefix;
+    std::unordered_set<std::string>& names;
+    std::vector<std::unordered_map<std::string, std::string>> scopes;
+
+    const std::string& lookup(const std::string& name) const {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            if (auto found = it->find(name); found != it->end()) {
+                return found->second;
+            }
+        }
+        throw std::runtime_error("[opt::Renamer::lookup] Unknown identifier: " + name);
+    }
+
+    std::unique_ptr<NodeCompoundStatement> cloneCompound(const NodeCompoundStatement& compound) {
+        auto clone = std::make_unique<NodeCompoundStatement>();
+        clone->statements = cloneBody(compound);
+        return clone;
+    }
+
+    NodeStatement cloneStatement(const NodeStatement& statement) {
+        return std::visit([this](const auto& stmt) -> NodeStatement {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementEmpty>) {
+                return NodeStatement{NodeStatementEmpty{}};
+            } else if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                NodeStatementReturn clone;
+                if (stmt.expression.has_value()) {
+                    clone.expression = cloneExpression(stmt.expression.value());
+                }
+                return NodeStatement{std::move(clone)};
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                NodeStatementVarDecl clone{declare(stmt.identifier), std::nullopt, stmt.zeroed};
+                if (stmt.initializer.has_value()) {
+                    clone.initializer = cloneExpression(stmt.initializer.value());
+                }
+                return NodeStatement{std::move(clone)};
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                return NodeStatement{NodeStatementAssignment{lookup(stmt.identifier), cloneExpression(stmt.expression)}};
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                NodeStatementIf clone{cloneExpression(stmt.condition), cloneCompound(*stmt.body), std::nullopt};
+                if (stmt.elseBody.has_value()) {
+                    clone.elseBody = cloneCompound(*stmt.elseBody.value());
+                }
+                return NodeStatement{std::move(clone)};
+            } else {
+                return NodeStatement{NodeStatementWhile{cloneExpression(stmt.condition), cloneCompound(*stmt.body)}};
+            }
+        }, statement.value);
+    }
+
+    NodeExpression cloneExpression(const NodeExpression& expression) {
+        return std::visit([this](const auto& expr) -> NodeExpression {
+            using T = std::decay_t<decltype(expr)>;
+            if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+                if (const auto* value = std::get_if<int>(&expr.value)) {
+                    return NodeExpression{NodeExpressionPrimary{*value}};
+                } else if (const auto* name = std::get_if<std::string>(&expr.value)) {
+                    return NodeExpression{NodeExpressionPrimary{lookup(*name)}};
+                }
+                const auto& inner = std::get<std::unique_ptr<NodeExpression>>(expr.value);
+                return NodeExpression{NodeExpressionPrimary{std::make_unique<NodeExpression>(cloneExpression(*inner))}};
+            } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+                NodeExpressionFunctionCall clone{expr.functionName, {}};
+                for (const auto& argument : expr.arguments) {
+                    clone.arguments.push_back(cloneExpression(argument));
+                }
+                return NodeExpression{std::move(clone)};
+            } else {
+                return NodeExpression{T{expr.op, std::make_unique<NodeExpression>(cloneExpression(*expr.left)),
+                                        std::make_unique<NodeExpression>(cloneExpression(*expr.right))}};
+            }
+        }, expression.value);
+    }
+};
+
+} // namespace
+
+Inliner::Inliner(const codegen::Options& options)
+    : threshold(options.optimizeSize ? std::min(options.inlineThreshold, 0) : options.inlineThreshold),
+      growthPercent(options.inlineGrowth), callGraph(nullptr), statistics(nullptr), caller(nullptr), expansions(0),
+      programSize(0), sizeLimit(0), callsInlined(0), callsKept(0) {}
+
+int Inliner::bodySize(const NodeCompoundStatement& compound) {
+    return compoundSize(compound);
+}
+
+const char* Inliner::name() const {
+    return "inliner";
+}
+
+bool Inliner::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& stats) {
+    callsInlined = callsKept = expansions = 0;
+    statistics = &stats;
+    callGraph = &analyses.getCallGraph();
+
+    functions.clear();
+    callSites.clear();
+    programSize = 0;
+    for (const auto& function : program.functions) {
+        functions[function.name] = &function;
+        collectCalls(function.body, callSites);
+        programSize += compoundSize(function.body);
+    }
+    sizeLimit = programSize + programSize * growthPercent / 100;
+    int originalSize = programSize;
+
+    // Callees first: a body is copied with its own calls already inlined
+    std::unordered_map<std::string, NodeFunction*> mutableFunctions;
+    for (auto& function : program.functions) {
+        mutableFunctions[function.name] = &function;
+    }
+    for (const auto& component : callGraph->components) {
+        for (const auto& name : component) {
+            NodeFunction* function = mutableFunctions.at(name);
+            caller = function;
+            callerNames.clear();
+            for (const auto& param : function->parameters) {
+                callerNames.insert(param.name);
+            }
+            collectDeclarations(function->body, callerNames);
+            function->body.statements = inlineStatements(std::move(function->body.statements));
+        }
+    }
+    caller = nullptr;
+
+    statistics->add(name(), "calls-inlined", callsInlined);
+    statistics->add(name(), "calls-kept", callsKept);
+    statistics->add(name(), "size-added", programSize - originalSize);
+    return callsInlined > 0;
+}
+
+std::vector<NodeStatement> Inliner::inlineStatements(std::vector<NodeStatement> statements) {
+    std::vector<NodeStatement> output;
+    for (auto& statement : statements) {
+        std::unordered_set<const NodeExpression*> considered;
+        bool kept = true;
+        while (NodeExpression* candidate = findCandidate(statement, considered)) {
+            considered.insert(candidate);
+            const auto& call = std::get<NodeExpressionFunctionCall>(candidate->value);
+            std::string site = call.functionName + " into " + caller->name;
+            std::string cost;
+            if (!shouldInline(call, cost)) {
+                statistics->remark(name(), "kept    " + site + ": " + cost);
+                callsKept++;
+                continue;
+            }
+
+            // The copy may hold calls of its own, and its arguments certainly can
+            std::vector<NodeStatement> expansion;
+            if (!expand(statement, *candidate, expansion, kept)) {
+                statistics->remark(name(), "kept    " + site + ": " + cost + ", returns from inside a loop");
+                callsKept++;
+                continue;
+            }
+            statistics->remark(name(), "inlined " + site + ": " + cost);
+            callsInlined++;
+            for (auto& expanded : inlineStatements(std::move(expansion))) {
+                output.push_back(std::move(expanded));
+            }
+            if (!kept) {
+                break;
+            }
+        }
+
+        if (kept) {
+            inlineNested(statement);
+            output.push_back(std::move(statement));
+        }
+    }
+    return output;
+}
+
+void Inliner::inlineNested(NodeStatement& statement) {
+    if (auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+        ifStmt->body->statements = inlineStatements(std::move(ifStmt->body->statements));
+        if (ifStmt->elseBody.has_value()) {
+            auto& elseBody = *ifStmt->elseBody.value();
+            elseBody.statements = inlineStatements(std::move(elseBody.statements));
+        }
+    } else if (auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+        whileStmt->body->statements = inlineStatements(std::move(whileStmt->body->statements));
+    }
+}
+
+NodeExpression* Inliner::findCandidate(NodeStatement& statement, std::unordered_set<const NodeExpression*>& considered) {
+    // First call of the statement's own expression not considered yet, outermost first
+    std::function<NodeExpression*(NodeExpression&)> search = [&](NodeExpression& expression) -> NodeExpression* {
+        if (std::holds_alternative<NodeExpressionFunctionCall>(expression.value) && !considered.count(&expression)) {
+            return &expression;
+        }
+        return std::visit([&](auto& expr) -> NodeExpression* {
+            using T = std::decay_t<decltype(expr)>;
+            if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+                auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value);
+                return inner ? search(**inner) : nullptr;
+            } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+                for (auto& argument : expr.arguments) {
+                    if (NodeExpression* found = search(argument)) {
+                        return found;
+                    }
+                }
+                return nullptr;
+            } else {
+                NodeExpression* found = search(*expr.left);
+                return found ? found : search(*expr.right);
+            }
+        }, expression.value);
+    };
+
+    return std::visit([&](auto& stmt) -> NodeExpression* {
+        using T = std::decay_t<decltype(stmt)>;
+        if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+            return stmt.expression.has_value() ? search(stmt.expression.value()) : nullptr;
+        } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+            return stmt.initializer.has_value() ? search(stmt.initializer.value()) : nullptr;
+        } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+            return search(stmt.expression);
+        } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+            return search(stmt.condition);
+        } else {
+            return nullptr;  // A while condition runs again every iteration, before the body
+        }
+    }, statement.value);
+}
+
+bool Inliner::shouldInline(const NodeExpressionFunctionCall& call, std::string& reason) const {
+    auto it = functions.find(call.functionName);
+    if (it == functions.end()) {
+        reason = "no body";
+        return false;
+    }
+    const NodeFunction& callee = *it->second;
+    if (callee.parameters.size() != call.arguments.size()) {
+        reason = "argument count differs";
+        return false;
+    }
+    if (callGraph->isRecursive(callee.name) || callGraph->inSameComponent(caller->name, callee.name)) {
+        reason = "recursive";
+        return false;
+    }
+
+    int size = compoundSize(callee.body);
+    int benefit = callBenefit + argumentBenefit * static_cast<int>(call.arguments.size());
+    for (const auto& argument : call.arguments) {
+        benefit += constantValue(argument).has_value() ? constantBenefit : 0;
+    }
+    auto sites = callSites.find(callee.name);
+    benefit += sites != callSites.end() && sites->second == 1 ? onlyCallBenefit : 0;
+
+    reason = "size " + std::to_string(size) + ", benefit " + std::to_string(benefit);
+    if (size - benefit > threshold) {
+        reason += ", over threshold " + std::to_string(threshold);
+        return false;
+    }
+    if (size > benefit && programSize + size > sizeLimit) {
+        reason += ", program would grow past " + std::to_string(sizeLimit);
+        return false;
+    }
+    return true;
+}
+
+bool Inliner::expand(NodeStatement& statement, NodeExpression& callExpression, std::vector<NodeStatement>& output,
+                     bool& statementKept) {
+    auto& call = std::get<NodeExpressionFunctionCall>(callExpression.value);
+    const NodeFunction& callee = *functions.at(call.functionName);
+
+    Renamer renamer(freshPrefix(callee.name), callerNames);
+    std::vector<std::string> parameters;
+    for (const auto& param : callee.parameters) {
+        parameters.push_back(renamer.declare(param.name));
+    }
+    std::vector<NodeStatement> body = renamer.cloneBody(callee.body);
+
+    // "return f(...)" keeps the returns of a body that never falls off its end
+    auto* returnStmt = std::get_if<NodeStatementReturn>(&statement.value);
+    bool tail = returnStmt && returnStmt->expression.has_value() && &returnStmt->expression.value() == &callExpression &&
+                alwaysExits(callee.body);
+
+    std::optional<NodeStatement> resultDeclaration;
+    std::string result;
+    bool replacesStatement = true;
+    if (tail) {
+        // Nothing to lower
+    } else if (auto* assignment = std::get_if<NodeStatementAssignment>(&statement.value);
+               assignment && &assignment->expression == &callExpression) {
+        result = assignment->identifier;
+    } else if (auto* varDecl = std::get_if<NodeStatementVarDecl>(&statement.value);
+               varDecl && varDecl->initializer.has_value() && &varDecl->initializer.value() == &callExpression) {
+        result = varDecl->identifier;
+        resultDeclaration = NodeStatement{NodeStatementVarDecl{result, std::nullopt}};
+    } else {
+        result = renamer.declare("result");
+        resultDeclaration = NodeStatement{NodeStatementVarDecl{result, std::nullopt}};
+        replacesStatement = false;
+    }
+
+    if (!tail && !lowerReturns(body, result)) {
+        return false;
+    }
+
+    // Arguments are evaluated once, in order, before the body
+    for (size_t i = 0; i < parameters.size(); i++) {
+        output.push_back(NodeStatement{NodeStatementVarDecl{parameters[i], std::move(call.arguments[i])}});
+    }
+    if (resultDeclaration.has_value()) {
+        output.push_back(std::move(resultDeclaration.value()));
+    }
+    std::move(body.begin(), body.end(), std::back_inserter(output));
+
+    if (!replacesStatement) {
+        callExpression = NodeExpression{NodeExpressionPrimary{result}};
+    }
+    statementKept = !replacesStatement;
+    programSize += compoundSize(callee.body);
+    return true;
+}
+
+std::string Inliner::freshPrefix(const std::string& callee) {
+    // A dot never appears in a source identifier, so copies cannot capture the caller's names
+    return callee + "." + std::to_string(++expansions) + ".";
+}
+
+} // namespace opt
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <unordered_set>
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Replaces calls by a copy of the callee's body, on the AST. Functions are visited callees
+   first, so a body is copied with its own calls already inlined. Parameters become locals
+   initialized with the arguments, every local of the copy gets a fresh name (it can contain
+   no dot in the source) and the copy goes right before the statement holding the call, whose
+   value is read from a result variable. Returns become assignments to that variable: the rest
+   of a block after an if whose branch always returns moves into the other branch, so no flag
+   is needed; a callee returning from inside a loop is only inlined as "return f(...)", where
+   its returns can stay. Calls in a while condition are evaluated once per iteration and stay.
+   The cost of a call is the size of the callee body in AST nodes, minus what inlining saves:
+   the call itself, moving the arguments, folding constant arguments and, for the only call
+   to a function, the function itself. Recursive calls and calls that would grow the program
+   past the limit stay, unless the copy is smaller than the call; every decision is left as a
+   remark for -inline-report. */
+class Inliner : public codegen::Pass {
+public:
+    explicit Inliner(const codegen::Options& options);
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+
+    static int bodySize(const NodeCompoundStatement& compound);  // AST nodes, the measure of code growth
+
+private:
+    int threshold;
+    int growthPercent;
+
+    const CallGraph* callGraph;
+    codegen::Statistics* statistics;
+    std::unordered_map<std::string, const NodeFunction*> functions;
+    std::unordered_map<std::string, int> callSites;
+    const NodeFunction* caller;
+    std::unordered_set<std::string> callerNames;  // Declared in the caller, for fresh names
+    int expansions;
+    int programSize;
+    int sizeLimit;
+
+    int callsInlined;
+    int callsKept;
+
+    std::vector<NodeStatement> inlineStatements(std::vector<NodeStatement> statements);
+    void inlineNested(NodeStatement& statement);
+    NodeExpression* findCandidate(NodeStatement& statement, std::unordered_set<const NodeExpression*>& considered);
+    bool shouldInline(const NodeExpressionFunctionCall& call, std::string& reason) const;
+    bool expand(NodeStatement& statement, NodeExpression& callExpression, std::vector<NodeStatement>& output,
+                bool& statementKept);
+    std::string freshPrefix(const std::string& callee);
+};
+
+} // namespace opt
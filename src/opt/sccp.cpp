@@ -0,0 +1,276 @@
+#include "sccp.hpp"
+#include <algorithm>
+#include "astRewriter.hpp"
+#include "constantFolding.hpp"
+
+namespace opt {
+
+using ir::Opcode;
+
+Sccp::Sccp() : function(nullptr), returns(nullptr), constantValues(0), branchesDecided(0), unreachableBlocks(0) {}
+
+const char* Sccp::name() const {
+    return "sccp";
+}
+
+bool Sccp::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) {
+    constantValues = branchesDecided = unreachableBlocks = 0;
+
+    // Solve everything first: rewriting the AST frees the nodes the IR points to
+    std::unordered_map<const NodeExpression*, int> constants;
+    for (const auto& irFunction : analyses.getIr().functions) {
+        solve(irFunction, constants);
+    }
+
+    AstRewriter rewriter([&constants](NodeExpression& expression) {
+        auto it = constants.find(&expression);
+        if (it == constants.end() || constantValue(expression).has_value() || hasCalls(expression)) {
+            return false;
+        }
+        expression = makeConstant(it->second);
+        return true;
+    });
+    int replaced = rewriter.run(program);
+
+    statistics.add(name(), "constant-values", constantValues);
+    statistics.add(name(), "expressions-replaced", replaced);
+    statistics.add(name(), "branches-decided", branchesDecided);
+    statistics.add(name(), "unreachable-blocks", unreachableBlocks);
+    return replaced > 0;
+}
+
+std::set<codegen::Analysis> Sccp::preserved() const {
+    // Expressions holding calls are never replaced
+    return {codegen::Analysis::Scopes, codegen::Analysis::CallGraph};
+}
+
+void Sccp::solve(const ir::Function& irFunction, std::unordered_map<const NodeExpression*, int>& constants,
+                 const std::unordered_map<std::string, int>& knownReturns) {
+    if (!irFunction.ssa) {
+        throw std::runtime_error("[opt::Sccp::solve] Function '" + irFunction.name + "' is not in SSA form");
+    }
+
+    function = &irFunction;
+    returns = &knownReturns;
+    returned = Lattice{};
+    values.assign(irFunction.valueCount, Lattice{});
+    users.assign(irFunction.valueCount, {});
+    executableBlocks.assign(irFunction.blocks.size(), false);
+    executableEdges.clear();
+    flowWorklist.clear();
+    valueWorklist.clear();
+
+    for (const auto& block : irFunction.blocks) {
+        for (const auto& instruction : block.instructions) {
+            for (int operand : instruction.operands) {
+                users[operand].emplace_back(&instruction, block.id);
+            }
+        }
+    }
+
+    executableBlocks[0] = true;
+    visitBlock(0, false);
+    while (!flowWorklist.empty() || !valueWorklist.empty()) {
+        while (!flowWorklist.empty()) {
+            auto [from, to] = flowWorklist.back();
+            flowWorklist.pop_back();
+            if (isExecutable(from, to)) {
+                continue;
+            }
+            executableEdges.emplace_back(from, to);
+
+            // A new edge into a visited block can only change its phis
+            bool visited = executableBlocks[to];
+            executableBlocks[to] = true;
+            visitBlock(to, visited);
+        }
+        while (!valueWorklist.empty()) {
+            int value = valueWorklist.back();
+            valueWorklist.pop_back();
+            for (const auto& [user, block] : users[value]) {
+                if (executableBlocks[block]) {
+                    visitInstruction(*user, block);
+                }
+            }
+        }
+    }
+
+    for (const auto& block : irFunction.blocks) {
+        if (!executableBlocks[block.id]) {
+            unreachableBlocks++;
+            continue;
+        }
+        for (const auto& instruction : block.instructions) {
+            if (instruction.opcode == Opcode::Branch && values[instruction.operands[0]].state == State::Constant) {
+                branchesDecided++;
+            }
+            if (instruction.opcode == Opcode::Return) {
+                meetReturn(instruction);
+            }
+            if (instruction.result < 0 || values[instruction.result].state != State::Constant) {
+                continue;
+            }
+            constantValues++;
+            if (instruction.expression) {
+                constants[instruction.expression] = static_cast<int>(values[instruction.result].value);
+            }
+        }
+    }
+    for (const auto& read : irFunction.variableReads) {
+        if (values[read.value].state == State::Constant) {
+            constants[read.expression] = static_cast<int>(values[read.value].value);
+        }
+    }
+
+    function = nullptr;
+    returns = nullptr;
+}
+
+void Sccp::meetReturn(const ir::Instruction& ret) {
+    // Falling off the end returns whatever rax holds
+    if (ret.operands.empty()) {
+        returned.state = State::Overdefined;
+        return;
+    }
+    const Lattice& value = values[ret.operands[0]];
+    if (value.state == State::Overdefined || (returned.state == State::Constant && value.state == State::Constant &&
+                                              returned.value != value.value)) {
+        returned.state = State::Overdefined;
+    } else if (value.state == State::Constant && returned.state == State::Unknown) {
+        returned = value;
+    }
+}
+
+std::optional<int> Sccp::returnedConstant() const {
+    if (returned.state != State::Constant) {
+        return std::nullopt;
+    }
+    return static_cast<int>(returned.value);
+}
+
+void Sccp::visitBlock(int block, bool phisOnly) {
+    for (const auto& instruction : function->blocks[block].instructions) {
+        if (phisOnly && instruction.opcode != Opcode::Phi) {
+            break;
+        }
+        visitInstruction(instruction, block);
+    }
+}
+
+void Sccp::visitInstruction(const ir::Instruction& instruction, int block) {
+    if (instruction.opcode == Opcode::Phi) {
+        visitPhi(instruction, block);
+    } else if (instruction.isTerminator()) {
+        visitTerminator(instruction, block);
+    } else if (instruction.result >= 0) {
+        update(instruction.result, evaluate(instruction));
+    }
+}
+
+void Sccp::visitPhi(const ir::Instruction& phi, int block) {
+    const auto& predecessors = function->blocks[block].predecessors;
+
+    Lattice merged;
+    for (size_t i = 0; i < phi.operands.size(); i++) {
+        if (!isExecutable(predecessors[i], block)) {
+            continue;
+        }
+        const Lattice& incoming = values[phi.operands[i]];
+        if (incoming.state == State::Unknown) {
+            continue;
+        }
+        if (incoming.state == State::Overdefined ||
+            (merged.state == State::Constant && merged.value != incoming.value)) {
+            merged.state = State::Overdefined;
+            break;
+        }
+        merged = incoming;
+    }
+    update(phi.result, merged);
+}
+
+void Sccp::visitTerminator(const ir::Instruction& terminator, int block) {
+    if (terminator.opcode == Opcode::Jump) {
+        markEdge(block, terminator.targets[0]);
+    } else if (terminator.opcode == Opcode::Branch) {
+        const Lattice& condition = values[terminator.operands[0]];
+        if (condition.state == State::Constant) {
+            markEdge(block, terminator.targets[condition.value != 0 ? 0 : 1]);
+        } else if (condition.state == State::Overdefined) {
+            markEdge(block, terminator.targets[0]);
+            markEdge(block, terminator.targets[1]);
+        }
+    }
+}
+
+Sccp::Lattice Sccp::evaluate(const ir::Instruction& instruction) const {
+    Lattice overdefined{State::Overdefined, 0};
+
+    switch (instruction.opcode) {
+        case Opcode::Const:
+            return {State::Constant, instruction.value};
+        case Opcode::Copy:
+            return values[instruction.operands[0]];
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Cmp:
+            break;
+        case Opcode::Call:
+            if (auto it = returns->find(instruction.callee); it != returns->end()) {
+                return {State::Constant, it->second};
+            }
+            return overdefined;
+        default:
+            // Parameters, undefined reads and call results are not known at compile time
+            return overdefined;
+    }
+
+    const Lattice& left = values[instruction.operands[0]];
+    const Lattice& right = values[instruction.operands[1]];
+    if (left.state == State::Overdefined || right.state == State::Overdefined) {
+        return overdefined;
+    }
+    if (left.state == State::Unknown || right.state == State::Unknown) {
+        return {};
+    }
+
+    using BinaryOperator = NodeExpressionBinary::BinaryOperator;
+    std::optional<int64_t> result;
+    switch (instruction.opcode) {
+        case Opcode::Add: result = opt::evaluate(BinaryOperator::Add, left.value, right.value); break;
+        case Opcode::Sub: result = opt::evaluate(BinaryOperator::Subtract, left.value, right.value); break;
+        case Opcode::Mul: result = opt::evaluate(BinaryOperator::Multiply, left.value, right.value); break;
+        case Opcode::Div: result = opt::evaluate(BinaryOperator::Divide, left.value, right.value); break;
+        default:          result = compare(instruction.comparison, left.value, right.value) ? 1 : 0; break;
+    }
+
+    // Overflow and division by zero stay at run time, as in constant folding
+    return result.has_value() ? Lattice{State::Constant, result.value()} : overdefined;
+}
+
+void Sccp::update(int value, Lattice lattice) {
+    Lattice& current = values[value];
+    if (lattice.state == State::Constant && current.state == State::Constant && lattice.value != current.value) {
+        lattice.state = State::Overdefined;
+    }
+    if (lattice.state < current.state ||
+        (lattice.state == current.state && (lattice.state != State::Constant || lattice.value == current.value))) {
+        return;
+    }
+    current = lattice;
+    valueWorklist.push_back(value);
+}
+
+void Sccp::markEdge(int from, int to) {
+    if (!isExecutable(from, to)) {
+        flowWorklist.emplace_back(from, to);
+    }
+}
+
+bool Sccp::isExecutable(int from, int to) const {
+    return std::find(executableEdges.begin(), executableEdges.end(), std::make_pair(from, to)) != executableEdges.end();
+}
+
+} // namespace opt
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <unordered_map>
+#include "../codegen/passManager.hpp"
+#include "../ir/ir.hpp"
+
+namespace opt {
+
+/* Sparse conditional constant propagation (Wegman and Zadeck) over the SSA IR. Values start
+   unknown and only move down the lattice unknown -> constant -> overdefined; a block is only
+   evaluated once an edge into it is found executable, and a branch on a constant only makes
+   its taken edge executable. Phis meet the values of their executable edges alone, so a
+   constant survives a join whose other side is dead.
+   Every call-free expression of the AST whose value is constant on all executable paths is
+   replaced by the literal; constant branch conditions become 0 or 1 literals, which is how
+   the unreachable side is marked for dead code elimination. */
+class Sccp : public codegen::Pass {
+public:
+    Sccp();
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+    std::set<codegen::Analysis> preserved() const override;
+
+    // Expressions of the function known to be constant, after solving. Calls to the functions
+    // listed in returns evaluate to the constant they always return.
+    void solve(const ir::Function& function, std::unordered_map<const NodeExpression*, int>& constants,
+               const std::unordered_map<std::string, int>& returns = {});
+
+    // The value every executable return of the last solved function returns, if one constant
+    std::optional<int> returnedConstant() const;
+
+private:
+    enum class State { Unknown, Constant, Overdefined };
+
+    struct Lattice {
+        State state = State::Unknown;
+        int64_t value = 0;
+    };
+
+    const ir::Function* function;
+    const std::unordered_map<std::string, int>* returns;
+    std::vector<Lattice> values;
+    std::vector<std::vector<std::pair<const ir::Instruction*, int>>> users;  // With their block
+    std::vector<bool> executableBlocks;
+    std::vector<std::pair<int, int>> executableEdges;
+    std::vector<std::pair<int, int>> flowWorklist;
+    std::vector<int> valueWorklist;
+    Lattice returned;
+
+    int constantValues;
+    int branchesDecided;
+    int unreachableBlocks;
+
+    void visitBlock(int block, bool phisOnly);
+    void visitInstruction(const ir::Instruction& instruction, int block);
+    void visitPhi(const ir::Instruction& phi, int block);
+    void visitTerminator(const ir::Instruction& terminator, int block);
+    Lattice evaluate(const ir::Instruction& instruction) const;
+    void update(int value, Lattice lattice);
+    void meetReturn(const ir::Instruction& ret);
+    void markEdge(int from, int to);
+    bool isExecutable(int from, int to) const;
+};
+
+} // namespace opt
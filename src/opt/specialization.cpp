@@ -0,0 +1,303 @@
+#include "specialization.hpp"
+#include <algorithm>
+#include <set>
+#include "astRewriter.hpp"
+#include "constantFolding.hpp"
+#include "inliner.hpp"
+
+namespace opt {
+
+namespace {
+
+NodeExpression copyExpression(const NodeExpression& expression);
+std::unique_ptr<NodeCompoundStatement> copyCompound(const NodeCompoundStatement& compound);
+
+NodeStatement copyStatement(const NodeStatement& statement) {
+    return std::visit([](const auto& stmt) -> NodeStatement {
+        using T = std::decay_t<decltype(stmt)>;
+        if constexpr (std::is_same_v<T, NodeStatementEmpty>) {
+            return NodeStatement{NodeStatementEmpty{}};
+        } else if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+            NodeStatementReturn copy;
+            if (stmt.expression.has_value()) {
+                copy.expression = copyExpression(stmt.expression.value());
+            }
+            return NodeStatement{std::move(copy)};
+        } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+            NodeStatementVarDecl copy{stmt.identifier, std::nullopt, stmt.zeroed};
+            if (stmt.initializer.has_value()) {
+                copy.initializer = copyExpression(stmt.initializer.value());
+            }
+            return NodeStatement{std::move(copy)};
+        } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+            return NodeStatement{NodeStatementAssignment{stmt.identifier, copyExpression(stmt.expression)}};
+        } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+            NodeStatementIf copy{copyExpression(stmt.condition), copyCompound(*stmt.body), std::nullopt};
+            if (stmt.elseBody.has_value()) {
+                copy.elseBody = copyCompound(*stmt.elseBody.value());
+            }
+            return NodeStatement{std::move(copy)};
+        } else {
+            return NodeStatement{NodeStatementWhile{copyExpression(stmt.condition), copyCompound(*stmt.body)}};
+        }
+    }, statement.value);
+}
+
+std::unique_ptr<NodeCompoundStatement> copyCompound(const NodeCompoundStatement& compound) {
+    auto copy = std::make_unique<NodeCompoundStatement>();
+    for (const auto& statement : compound.statements) {
+        copy->statements.push_back(copyStatement(statement));
+    }
+    return copy;
+}
+
+NodeExpression copyExpression(const NodeExpression& expression) {
+    return std::visit([](const auto& expr) -> NodeExpression {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            if (const auto* value = std::get_if<int>(&expr.value)) {
+                return NodeExpression{NodeExpressionPrimary{*value}};
+            } else if (const auto* name = std::get_if<std::string>(&expr.value)) {
+                return NodeExpression{NodeExpressionPrimary{*name}};
+            }
+            const auto& inner = std::get<std::unique_ptr<NodeExpression>>(expr.value);
+            return NodeExpression{NodeExpressionPrimary{std::make_unique<NodeExpression>(copyExpression(*inner))}};
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            NodeExpressionFunctionCall copy{expr.functionName, {}};
+            for (const auto& argument : expr.arguments) {
+                copy.arguments.push_back(copyExpression(argument));
+            }
+            return NodeExpression{std::move(copy)};
+        } else {
+            return NodeExpression{T{expr.op, std::make_unique<NodeExpression>(copyExpression(*expr.left)),
+                                    std::make_unique<NodeExpression>(copyExpression(*expr.right))}};
+        }
+    }, expression.value);
+}
+
+// Names assigned or declared anywhere in the compound
+void collectWritten(const NodeCompoundStatement& compound, std::unordered_set<std::string>& names) {
+    for (const auto& statement : compound.statements) {
+        if (const auto* varDecl = std::get_if<NodeStatementVarDecl>(&statement.value)) {
+            names.insert(varDecl->identifier);
+        } else if (const auto* assignment = std::get_if<NodeStatementAssignment>(&statement.value)) {
+            names.insert(assignment->identifier);
+        } else if (const auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+            collectWritten(*ifStmt->body, names);
+            if (ifStmt->elseBody.has_value()) {
+                collectWritten(*ifStmt->elseBody.value(), names);
+            }
+        } else if (const auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            collectWritten(*whileStmt->body, names);
+        }
+    }
+}
+
+bool declaresAtTop(const NodeCompoundStatement& compound, const std::string& name) {
+    return std::any_of(compound.statements.begin(), compound.statements.end(), [&name](const NodeStatement& statement) {
+        const auto* varDecl = std::get_if<NodeStatementVarDecl>(&statement.value);
+        return varDecl && varDecl->identifier == name;
+    });
+}
+
+} // namespace
+
+Specialization::Specialization(const codegen::Options& options)
+    : cloneLimit(options.specializeLimit), growthPercent(options.specializeGrowth) {}
+
+const char* Specialization::name() const {
+    return "specialization";
+}
+
+bool Specialization::run(NodeProgram& program, codegen::AnalysisCache&, codegen::Statistics& statistics) {
+    std::unordered_map<std::string, size_t> indexes;
+    int programSize = 0;
+    for (size_t i = 0; i < program.functions.size(); i++) {
+        indexes[program.functions[i].name] = i;
+        programSize += Inliner::bodySize(program.functions[i].body);
+    }
+
+    // Every call passing constants, as its callee and the constants it passes
+    std::vector<std::pair<std::string, Pattern>> sites;
+    AstRewriter collector([&](NodeExpression& expression) {
+        const auto* call = std::get_if<NodeExpressionFunctionCall>(&expression.value);
+        auto it = call ? indexes.find(call->functionName) : indexes.end();
+        if (it != indexes.end() && program.functions[it->second].parameters.size() == call->arguments.size()) {
+            Pattern pattern = patternOf(*call);
+            if (std::any_of(pattern.begin(), pattern.end(), [](const auto& value) { return value.has_value(); })) {
+                sites.emplace_back(call->functionName, std::move(pattern));
+            }
+        }
+        return false;
+    });
+    collector.run(program);
+
+    // Greedily, the constants shared by the most calls not served yet, weighed by how many
+    // parameters they remove. A call may share only some of its constants with the others.
+    std::vector<std::pair<std::string, Pattern>> chosen;
+    std::set<std::pair<std::string, Pattern>> tooLarge;
+    std::vector<bool> served(sites.size(), false);
+    std::vector<NodeFunction> created;
+    int sizeLimit = programSize * growthPercent / 100;
+    int sizeAdded = 0;
+    while (static_cast<int>(chosen.size()) < cloneLimit) {
+        std::map<std::pair<std::string, Pattern>, int> uses;
+        for (size_t i = 0; i < sites.size(); i++) {
+            if (!served[i]) {
+                for (auto& subset : subsetsOf(sites[i].second)) {
+                    uses[{sites[i].first, std::move(subset)}]++;
+                }
+            }
+        }
+
+        const std::pair<std::string, Pattern>* best = nullptr;
+        int bestScore = 0;
+        int bestConstants = 0;
+        for (const auto& [key, calls] : uses) {
+            int constants = static_cast<int>(std::count_if(key.second.begin(), key.second.end(),
+                                                           [](const auto& value) { return value.has_value(); }));
+            int score = calls * constants;
+            bool better = score > bestScore || (score == bestScore && constants > bestConstants);
+            if (calls >= minimumCalls && better && !tooLarge.count(key)) {
+                best = &key;
+                bestScore = score;
+                bestConstants = constants;
+            }
+        }
+        if (!best) {
+            break;
+        }
+
+        const NodeFunction& callee = program.functions[indexes.at(best->first)];
+        int size = Inliner::bodySize(callee.body);
+        std::string cloneName = callee.name + ".spec" + std::to_string(chosen.size() + 1);
+        if (sizeAdded + size > sizeLimit || indexes.count(cloneName)) {
+            tooLarge.insert(*best);
+            continue;
+        }
+        for (size_t i = 0; i < sites.size(); i++) {
+            served[i] = served[i] || (sites[i].first == best->first && matches(best->second, sites[i].second));
+        }
+        created.push_back(specialize(callee, best->second, cloneName));
+        chosen.push_back(*best);
+        sizeAdded += size;
+    }
+
+    // Calls, in the clones too, go to the first clone whose constants they pass, without them
+    std::vector<std::string> cloneNames;
+    for (const auto& clone : created) {
+        cloneNames.push_back(clone.name);
+    }
+    std::move(created.begin(), created.end(), std::back_inserter(program.functions));
+
+    int redirected = 0;
+    AstRewriter redirect([&](NodeExpression& expression) {
+        auto* call = std::get_if<NodeExpressionFunctionCall>(&expression.value);
+        if (!call) {
+            return false;
+        }
+        Pattern pattern = patternOf(*call);
+        auto it = std::find_if(chosen.begin(), chosen.end(), [&](const auto& clone) {
+            return clone.first == call->functionName && matches(clone.second, pattern);
+        });
+        if (it == chosen.end()) {
+            return false;
+        }
+        std::vector<NodeExpression> arguments;
+        for (size_t i = 0; i < call->arguments.size(); i++) {
+            if (!it->second[i].has_value()) {
+                arguments.push_back(std::move(call->arguments[i]));
+            }
+        }
+        call->arguments = std::move(arguments);
+        call->functionName = cloneNames[it - chosen.begin()];
+        redirected++;
+        return false;  // The remaining arguments may hold calls as well
+    });
+    redirect.run(program);
+
+    statistics.add(name(), "clones-created", static_cast<int>(chosen.size()));
+    statistics.add(name(), "calls-redirected", redirected);
+    statistics.add(name(), "size-added", sizeAdded);
+    return !chosen.empty();
+}
+
+std::vector<Specialization::Pattern> Specialization::subsetsOf(const Pattern& pattern) {
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i].has_value()) {
+            positions.push_back(i);
+        }
+    }
+    std::vector<Pattern> subsets;
+    for (unsigned mask = 1; mask < (1u << positions.size()); mask++) {
+        Pattern subset(pattern.size());
+        for (size_t bit = 0; bit < positions.size(); bit++) {
+            if (mask & (1u << bit)) {
+                subset[positions[bit]] = pattern[positions[bit]];
+            }
+        }
+        subsets.push_back(std::move(subset));
+    }
+    return subsets;
+}
+
+bool Specialization::matches(const Pattern& clone, const Pattern& call) {
+    if (clone.size() != call.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < clone.size(); i++) {
+        if (clone[i].has_value() && clone[i] != call[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Specialization::Pattern Specialization::patternOf(const NodeExpressionFunctionCall& call) {
+    Pattern pattern;
+    for (const auto& argument : call.arguments) {
+        pattern.push_back(constantValue(argument));
+    }
+    return pattern;
+}
+
+NodeFunction Specialization::specialize(const NodeFunction& function, const Pattern& pattern, const std::string& cloneName) {
+    NodeFunction clone{function.type, cloneName, {}, std::move(*copyCompound(function.body))};
+
+    // A parameter the body redeclares at its top is never read, one it writes becomes a local
+    std::unordered_set<std::string> written;
+    collectWritten(function.body, written);
+    std::unordered_map<std::string, int> substituted;
+    std::vector<NodeStatement> statements;
+    for (size_t i = 0; i < function.parameters.size(); i++) {
+        const FunctionParameter& param = function.parameters[i];
+        if (!pattern[i].has_value()) {
+            clone.parameters.push_back(param);
+        } else if (declaresAtTop(function.body, param.name)) {
+            continue;
+        } else if (written.count(param.name)) {
+            statements.push_back(NodeStatement{NodeStatementVarDecl{param.name, makeConstant(pattern[i].value())}});
+        } else {
+            substituted[param.name] = pattern[i].value();
+        }
+    }
+
+    AstRewriter substitute([&substituted](NodeExpression& expression) {
+        const auto* primary = std::get_if<NodeExpressionPrimary>(&expression.value);
+        const auto* name = primary ? std::get_if<std::string>(&primary->value) : nullptr;
+        auto it = name ? substituted.find(*name) : substituted.end();
+        if (it == substituted.end()) {
+            return false;
+        }
+        expression = makeConstant(it->second);
+        return true;
+    });
+    substitute.visitCompound(clone.body);
+
+    std::move(clone.body.statements.begin(), clone.body.statements.end(), std::back_inserter(statements));
+    clone.body.statements = std::move(statements);
+    return clone;
+}
+
+} // namespace opt
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Function specialization: a callee that calls pass the same constants to gets a clone
+   without those parameters, and those calls go to the clone. Inside it a parameter that is
+   never assigned nor redeclared is replaced by its constant, any other one becomes a local
+   initialized with it; SCCP and folding, which run next, then fold the clone. Recursive calls
+   passing the same constants on go to the clone too. Clones are picked greedily: the constants
+   most calls not served yet share, by calls times parameters removed, at least two calls, as
+   long as the clone limit and the growth limit (in AST nodes, like the inliner's) allow.
+   Constant arguments have no effect, so they can go. */
+class Specialization : public codegen::Pass {
+public:
+    explicit Specialization(const codegen::Options& options);
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+
+private:
+    // The constant arguments of a call, by position
+    using Pattern = std::vector<std::optional<int>>;
+
+    static constexpr int minimumCalls = 2;
+
+    int cloneLimit;
+    int growthPercent;
+
+    static Pattern patternOf(const NodeExpressionFunctionCall& call);
+    static std::vector<Pattern> subsetsOf(const Pattern& pattern);  // Keeping some of the constants
+    static bool matches(const Pattern& clone, const Pattern& call);
+    static NodeFunction specialize(const NodeFunction& function, const Pattern& pattern, const std::string& cloneName);
+};
+
+} // namespace opt
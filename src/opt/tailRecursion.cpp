@@ -0,0 +1,208 @@
+#include "tailRecursion.hpp"
+#include <algorithm>
+#include "constantFolding.hpp"
+#include "deadCodeElimination.hpp"
+
+namespace opt {
+
+namespace {
+
+using BinaryOperator = NodeExpressionBinary::BinaryOperator;
+
+constexpr size_t maxParameters = 6;  // All passed in registers, see VisitorAnalyzer
+const std::string accumulator = "tail.acc";  // A dot never appears in a source identifier
+
+NodeExpression& unwrap(NodeExpression& expression) {
+    auto* primary = std::get_if<NodeExpressionPrimary>(&expression.value);
+    if (primary && std::holds_alternative<std::unique_ptr<NodeExpression>>(primary->value)) {
+        return unwrap(*std::get<std::unique_ptr<NodeExpression>>(primary->value));
+    }
+    return expression;
+}
+
+int callsTo(const NodeExpression& expression, const std::string& callee) {
+    return std::visit([&](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value);
+            return inner ? callsTo(**inner, callee) : 0;
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            int calls = expr.functionName == callee ? 1 : 0;
+            for (const auto& argument : expr.arguments) {
+                calls += callsTo(argument, callee);
+            }
+            return calls;
+        } else {
+            return callsTo(*expr.left, callee) + callsTo(*expr.right, callee);
+        }
+    }, expression.value);
+}
+
+int callsTo(const NodeCompoundStatement& compound, const std::string& callee) {
+    int calls = 0;
+    for (const auto& statement : compound.statements) {
+        calls += std::visit([&](const auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                return stmt.expression.has_value() ? callsTo(stmt.expression.value(), callee) : 0;
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                return stmt.initializer.has_value() ? callsTo(stmt.initializer.value(), callee) : 0;
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                return callsTo(stmt.expression, callee);
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                int calls = callsTo(stmt.condition, callee) + callsTo(*stmt.body, callee);
+                return stmt.elseBody.has_value() ? calls + callsTo(*stmt.elseBody.value(), callee) : calls;
+            } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                return callsTo(stmt.condition, callee) + callsTo(*stmt.body, callee);
+            } else {
+                return 0;
+            }
+        }, statement.value);
+    }
+    return calls;
+}
+
+void collectReturns(NodeCompoundStatement& compound, std::vector<NodeStatementReturn*>& returns) {
+    for (auto& statement : compound.statements) {
+        if (auto* returnStmt = std::get_if<NodeStatementReturn>(&statement.value)) {
+            returns.push_back(returnStmt);
+        } else if (auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+            collectReturns(*ifStmt->body, returns);
+            if (ifStmt->elseBody.has_value()) {
+                collectReturns(*ifStmt->elseBody.value(), returns);
+            }
+        } else if (auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            collectReturns(*whileStmt->body, returns);
+        }
+    }
+}
+
+// The expression when it is a call to function whose arguments do not call it again
+NodeExpression* recursiveCall(NodeExpression& expression, const std::string& function) {
+    NodeExpression& inner = unwrap(expression);
+    const auto* call = std::get_if<NodeExpressionFunctionCall>(&inner.value);
+    if (!call || call->functionName != function) {
+        return nullptr;
+    }
+    bool nested = std::any_of(call->arguments.begin(), call->arguments.end(), [&](const NodeExpression& argument) {
+        return callsTo(argument, function) > 0;
+    });
+    return nested ? nullptr : &inner;
+}
+
+NodeExpression variable(const std::string& name) {
+    return NodeExpression{NodeExpressionPrimary{name}};
+}
+
+NodeExpression combine(BinaryOperator op, NodeExpression left, NodeExpression right) {
+    return NodeExpression{NodeExpressionBinary{op, std::make_unique<NodeExpression>(std::move(left)),
+                                               std::make_unique<NodeExpression>(std::move(right))}};
+}
+
+} // namespace
+
+const char* TailRecursion::name() const {
+    return "tail-recursion";
+}
+
+bool TailRecursion::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) {
+    const CallGraph& graph = analyses.getCallGraph();
+    std::unordered_set<std::string> names(graph.functions.begin(), graph.functions.end());
+
+    int accumulators = 0;
+    int callsMoved = 0;
+    for (size_t i = 0; i < program.functions.size(); i++) {
+        NodeFunction& function = program.functions[i];
+        const std::string copyName = function.name + ".acc";
+        bool exits = std::any_of(function.body.statements.begin(), function.body.statements.end(),
+                                 DeadCodeElimination::neverFallsThrough);
+        if (function.parameters.size() >= maxParameters || names.count(copyName) || !graph.isRecursive(function.name) ||
+            !exits) {
+            continue;
+        }
+
+        // Every recursive call must be a whole return value or an operand of one, under one operator
+        std::vector<NodeStatementReturn*> returns;
+        collectReturns(function.body, returns);
+        std::optional<BinaryOperator> op;
+        int recursive = 0;
+        bool accepted = true;
+        for (auto* returnStmt : returns) {
+            if (!returnStmt->expression.has_value()) {
+                accepted = false;
+                break;
+            }
+            NodeExpression& value = returnStmt->expression.value();
+            if (callsTo(value, function.name) == 0) {
+                continue;
+            }
+            recursive++;
+            if (recursiveCall(value, function.name)) {
+                continue;
+            }
+            auto* binary = std::get_if<NodeExpressionBinary>(&unwrap(value).value);
+            if (!binary || (binary->op != BinaryOperator::Add && binary->op != BinaryOperator::Multiply) ||
+                (op.has_value() && op.value() != binary->op)) {
+                accepted = false;
+                break;
+            }
+            bool callLeft = recursiveCall(*binary->left, function.name) != nullptr;
+            const NodeExpression& operand = callLeft ? *binary->right : *binary->left;
+            if ((!callLeft && !recursiveCall(*binary->right, function.name)) || callsTo(operand, function.name) > 0 ||
+                !callsAtMost(operand, graph, Purity::Pure)) {
+                accepted = false;
+                break;
+            }
+            op = binary->op;
+        }
+        if (!accepted || !op.has_value() || recursive != callsTo(function.body, function.name)) {
+            continue;
+        }
+
+        for (auto* returnStmt : returns) {
+            NodeExpression& value = returnStmt->expression.value();
+            if (callsTo(value, function.name) == 0) {
+                value = combine(op.value(), variable(accumulator), std::move(value));
+                continue;
+            }
+            if (NodeExpression* call = recursiveCall(value, function.name)) {
+                auto& tailCall = std::get<NodeExpressionFunctionCall>(call->value);
+                tailCall.functionName = copyName;
+                tailCall.arguments.push_back(variable(accumulator));
+                continue;
+            }
+
+            // e op f(...) becomes f.acc(..., acc op e)
+            auto& binary = std::get<NodeExpressionBinary>(unwrap(value).value);
+            bool callLeft = recursiveCall(*binary.left, function.name) != nullptr;
+            NodeExpression call = std::move(unwrap(callLeft ? *binary.left : *binary.right));
+            NodeExpression operand = std::move(callLeft ? *binary.right : *binary.left);
+            auto& tailCall = std::get<NodeExpressionFunctionCall>(call.value);
+            tailCall.functionName = copyName;
+            tailCall.arguments.push_back(combine(op.value(), variable(accumulator), std::move(operand)));
+            value = std::move(call);
+            callsMoved++;
+        }
+
+        // f(...) only starts the copy with the operator's identity
+        NodeFunction copy{function.type, copyName, function.parameters, std::move(function.body)};
+        copy.parameters.push_back(FunctionParameter{FunctionParameter::ParameterType::Int, accumulator});
+        NodeExpressionFunctionCall entry{copyName, {}};
+        for (const auto& param : function.parameters) {
+            entry.arguments.push_back(variable(param.name));
+        }
+        entry.arguments.push_back(makeConstant(op.value() == BinaryOperator::Add ? 0 : 1));
+        function.body = NodeCompoundStatement{};
+        function.body.statements.push_back(NodeStatement{NodeStatementReturn{NodeExpression{std::move(entry)}}});
+
+        program.functions.insert(program.functions.begin() + static_cast<std::ptrdiff_t>(i) + 1, std::move(copy));
+        i++;
+        accumulators++;
+    }
+
+    statistics.add(name(), "accumulators-added", accumulators);
+    statistics.add(name(), "calls-moved-to-tail", callsMoved);
+    return accumulators > 0;
+}
+
+} // namespace opt
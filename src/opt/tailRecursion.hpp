@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../codegen/passManager.hpp"
+
+namespace opt {
+
+/* Accumulator introduction, so that recursion written as "return n * f(n - 1)" ends in a tail
+   call the code generator turns into a jump. When every recursive call of f is the whole value
+   of a return, or one operand of a + or * making it up whose other operand has no effect, f
+   gets a copy f.acc taking the pending sum or product as an extra parameter: its recursive
+   returns pass "acc op e" on in a tail call and its other returns give "acc op value". f itself
+   calls the copy with 0 or 1 and is small enough to be inlined. Wrapping int arithmetic is
+   associative and commutative, so combining the operands in the other order changes nothing. */
+class TailRecursion : public codegen::Pass {
+public:
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+};
+
+} // namespace opt
@@ -0,0 +1,456 @@
+#include "valueNumbering.hpp"
+#include <algorithm>
+#include <functional>
+#include "constantFolding.hpp"
+#include "../ir/dominatorTree.hpp"
+
+namespace opt {
+
+using ir::Opcode;
+
+namespace {
+
+NodeExpression makeIdentifier(const std::string& name) {
+    return NodeExpression{NodeExpressionPrimary{name}};
+}
+
+} // namespace
+
+bool ValueNumbering::Key::operator<(const Key& other) const {
+    return std::tie(opcode, extra, callee, operands) < std::tie(other.opcode, other.extra, other.callee, other.operands);
+}
+
+ValueNumbering::ValueNumbering(bool global)
+    : global(global), callGraph(nullptr), expressionsReused(0), temporariesAdded(0), variablesReused(0) {}
+
+const char* ValueNumbering::name() const {
+    return global ? "global-value-numbering" : "local-value-numbering";
+}
+
+bool ValueNumbering::run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) {
+    expressionsReused = temporariesAdded = variablesReused = 0;
+    reads.clear();
+    temporaries.clear();
+    insertions.clear();
+    callGraph = &analyses.getCallGraph();
+
+    // Decide everything on the IR first: rewriting the AST frees the nodes it points to
+    for (const auto& function : analyses.getIr().functions) {
+        if (!function.ssa) {
+            throw std::runtime_error("[opt::ValueNumbering::run] Function '" + function.name + "' is not in SSA form");
+        }
+
+        sites.clear();
+        paths.clear();
+        declarations.clear();
+        assignments.clear();
+        for (const auto& param : function.source->parameters) {
+            declarations[param.name]++;
+        }
+        Path path;
+        collectCompound(function.source->body, path);
+
+        numberValues(function);
+        planRewrites(findRedundancies(function));
+    }
+
+    if (expressionsReused == 0) {
+        statistics.add(name(), "expressions-reused", 0);
+        return false;
+    }
+
+    for (auto& function : program.functions) {
+        rewriteCompound(function.body);
+        insertDeclarations(function.body);
+    }
+
+    statistics.add(name(), "expressions-reused", expressionsReused);
+    statistics.add(name(), "temporaries-added", temporariesAdded);
+    statistics.add(name(), "variables-reused", variablesReused);
+    return true;
+}
+
+bool ValueNumbering::isReusable(const ir::Instruction& instruction) const {
+    switch (instruction.opcode) {
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+            return true;
+        case Opcode::Call:
+            return callGraph->purityOf(instruction.callee) != Purity::SideEffecting;
+        default:
+            return false;
+    }
+}
+
+void ValueNumbering::numberValues(const ir::Function& function) {
+    numbers.assign(function.valueCount, -1);
+    numbering.clear();
+    int next = 0;
+
+    auto numberOf = [&](Key key) {
+        for (int operand : key.operands) {
+            if (operand < 0) {
+                return next++;  // Operand not numbered yet (a loop phi): nothing to match
+            }
+        }
+        auto [it, inserted] = numbering.try_emplace(std::move(key), next);
+        if (inserted) {
+            next++;
+        }
+        return it->second;
+    };
+
+    // Reverse postorder numbers every operand before its users, phis on back edges aside
+    for (int id : function.reversePostorder()) {
+        for (const auto& instruction : function.blocks[id].instructions) {
+            if (instruction.result < 0) {
+                continue;
+            }
+
+            std::vector<int> operands;
+            for (int operand : instruction.operands) {
+                operands.push_back(numbers[operand]);
+            }
+
+            int number;
+            switch (instruction.opcode) {
+                case Opcode::Copy:
+                    number = operands[0] >= 0 ? operands[0] : next++;
+                    break;
+                case Opcode::Const:
+                    number = numberOf({Opcode::Const, instruction.value, "", {}});
+                    break;
+                case Opcode::Add:
+                case Opcode::Mul:
+                    std::sort(operands.begin(), operands.end());
+                    number = numberOf({instruction.opcode, 0, "", operands});
+                    break;
+                case Opcode::Sub:
+                case Opcode::Div:
+                    number = numberOf({instruction.opcode, 0, "", operands});
+                    break;
+                case Opcode::Cmp:
+                    number = numberOf({Opcode::Cmp, static_cast<int64_t>(instruction.comparison), "", operands});
+                    break;
+                case Opcode::Phi:
+                    if (std::adjacent_find(operands.begin(), operands.end(), std::not_equal_to<>()) == operands.end() &&
+                        operands[0] >= 0) {
+                        number = operands[0];  // Every edge brings the same value
+                    } else {
+                        number = numberOf({Opcode::Phi, id, "", operands});
+                    }
+                    break;
+                case Opcode::Call:
+                    // A function with side effects may return something else every time
+                    number = isReusable(instruction) ? numberOf({Opcode::Call, 0, instruction.callee, operands}) : next++;
+                    break;
+                default:
+                    number = next++;  // Parameters and undefined reads are all distinct
+                    break;
+            }
+            numbers[instruction.result] = number;
+        }
+    }
+}
+
+std::vector<ValueNumbering::Redundancy> ValueNumbering::findRedundancies(const ir::Function& function) {
+    std::vector<Redundancy> redundancies;
+    std::unordered_map<const NodeExpression*, size_t> groups;  // Leader to its redundancy
+
+    // Leaders available in the block being visited, innermost last
+    std::unordered_map<int, std::vector<const NodeExpression*>> available;
+
+    auto visitBlock = [&](int id, std::vector<int>& entered) {
+        for (const auto& instruction : function.blocks[id].instructions) {
+            if (!isReusable(instruction) || !instruction.expression) {
+                continue;
+            }
+            auto siteIt = sites.find(instruction.expression);
+            if (siteIt == sites.end() || !callsAtMost(*instruction.expression, *callGraph, Purity::ReadOnly)) {
+                continue;
+            }
+            const Site& site = siteIt->second;
+            int number = numbers[instruction.result];
+
+            auto& leaders = available[number];
+            if (!leaders.empty()) {
+                const NodeExpression* leader = leaders.back();
+                bool held = heldBy(*leader) != nullptr;
+                if (visibleFrom(sites.at(leader).statement, site.statement, held)) {
+                    auto [it, inserted] = groups.try_emplace(leader, redundancies.size());
+                    if (inserted) {
+                        redundancies.push_back({leader, {}});
+                    }
+                    redundancies[it->second].followers.push_back(instruction.expression);
+                    continue;
+                }
+            }
+
+            // A loop condition runs once per iteration, there is no single place to compute it
+            if (!site.repeated) {
+                leaders.push_back(instruction.expression);
+                entered.push_back(number);
+            }
+        }
+    };
+
+    auto leave = [&](const std::vector<int>& entered) {
+        for (int number : entered) {
+            available[number].pop_back();
+        }
+    };
+
+    if (global) {
+        ir::DominatorTree tree(function);
+        std::function<void(int)> visit = [&](int id) {
+            std::vector<int> entered;
+            visitBlock(id, entered);
+            for (int child : tree.children(id)) {
+                visit(child);
+            }
+            leave(entered);
+        };
+        visit(0);
+    } else {
+        for (const auto& block : function.blocks) {
+            std::vector<int> entered;
+            visitBlock(block.id, entered);
+            leave(entered);
+        }
+    }
+    return redundancies;
+}
+
+void ValueNumbering::planRewrites(std::vector<Redundancy> redundancies) {
+    // Largest expressions first: a redundant subtree read from a variable is gone, so the
+    // smaller redundancies inside it no longer count
+    std::stable_sort(redundancies.begin(), redundancies.end(), [this](const Redundancy& a, const Redundancy& b) {
+        return sites.at(a.leader).size > sites.at(b.leader).size;
+    });
+
+    std::unordered_set<const NodeExpression*> replaced;
+    for (auto& redundancy : redundancies) {
+        if (insideAny(redundancy.leader, replaced)) {
+            continue;
+        }
+        std::erase_if(redundancy.followers, [&](const NodeExpression* follower) {
+            return insideAny(follower, replaced);
+        });
+        if (redundancy.followers.empty()) {
+            continue;
+        }
+
+        std::string variable;
+        if (const std::string* held = heldBy(*redundancy.leader)) {
+            variable = *held;
+            variablesReused++;
+        } else {
+            // A dot never appears in a source identifier, so the name cannot collide
+            int index = 0;
+            while (declarations.count("cse." + std::to_string(index))) {
+                index++;
+            }
+            variable = "cse." + std::to_string(index);
+            declarations[variable]++;
+            temporaries[redundancy.leader] = variable;
+            temporariesAdded++;
+        }
+
+        for (const NodeExpression* follower : redundancy.followers) {
+            reads[follower] = variable;
+            replaced.insert(follower);
+        }
+        expressionsReused += static_cast<int>(redundancy.followers.size());
+    }
+}
+
+void ValueNumbering::collectCompound(const NodeCompoundStatement& compound, Path& path) {
+    for (size_t i = 0; i < compound.statements.size(); i++) {
+        const NodeStatement& statement = compound.statements[i];
+        path.emplace_back(&compound, i);
+        paths[&statement] = path;
+
+        std::visit([&](const auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                if (stmt.expression.has_value()) {
+                    collectExpression(stmt.expression.value(), nullptr, &statement, false);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                declarations[stmt.identifier]++;
+                if (stmt.initializer.has_value()) {
+                    collectExpression(stmt.initializer.value(), nullptr, &statement, false);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                assignments[stmt.identifier]++;
+                collectExpression(stmt.expression, nullptr, &statement, false);
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                collectExpression(stmt.condition, nullptr, &statement, false);
+                collectCompound(*stmt.body, path);
+                if (stmt.elseBody.has_value()) {
+                    collectCompound(*stmt.elseBody.value(), path);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                collectExpression(stmt.condition, nullptr, &statement, true);
+                collectCompound(*stmt.body, path);
+            }
+        }, statement.value);
+
+        path.pop_back();
+    }
+}
+
+int ValueNumbering::collectExpression(const NodeExpression& expression, const NodeExpression* parent,
+                                      const NodeStatement* statement, bool repeated) {
+    int size = 1 + std::visit([&](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            const auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value);
+            return inner ? collectExpression(**inner, &expression, statement, repeated) : 0;
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            int arguments = 0;
+            for (const auto& argument : expr.arguments) {
+                arguments += collectExpression(argument, &expression, statement, repeated);
+            }
+            return arguments;
+        } else {
+            return collectExpression(*expr.left, &expression, statement, repeated) +
+                   collectExpression(*expr.right, &expression, statement, repeated);
+        }
+    }, expression.value);
+
+    sites[&expression] = {statement, parent, repeated, size};
+    return size;
+}
+
+bool ValueNumbering::insideAny(const NodeExpression* expression, const std::unordered_set<const NodeExpression*>& roots) const {
+    for (; expression; expression = sites.at(expression).parent) {
+        if (roots.count(expression)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ValueNumbering::visibleFrom(const NodeStatement* leader, const NodeStatement* follower, bool strictlyAfter) const {
+    // Dominance alone is not enough: a leader in a then-branch dominates the code after an
+    // if whose else-branch returns, but a local declared there is out of scope
+    const Path& leaderPath = paths.at(leader);
+    const Path& followerPath = paths.at(follower);
+    if (leaderPath.size() > followerPath.size()) {
+        return false;
+    }
+
+    size_t last = leaderPath.size() - 1;
+    if (!std::equal(leaderPath.begin(), leaderPath.begin() + last, followerPath.begin())) {
+        return false;
+    }
+    const auto& [compound, index] = leaderPath[last];
+    const auto& [followerCompound, followerIndex] = followerPath[last];
+    return compound == followerCompound && (strictlyAfter ? followerIndex > index : followerIndex >= index);
+}
+
+const std::string* ValueNumbering::heldBy(const NodeExpression& leader) const {
+    // "int v = leader;" with v never assigned and no other v in the function to shadow it
+    const auto* varDecl = std::get_if<NodeStatementVarDecl>(&sites.at(&leader).statement->value);
+    if (!varDecl || !varDecl->initializer.has_value() || &varDecl->initializer.value() != &leader) {
+        return nullptr;
+    }
+    auto assigned = assignments.find(varDecl->identifier);
+    bool unique = declarations.at(varDecl->identifier) == 1 && assigned == assignments.end();
+    return unique ? &varDecl->identifier : nullptr;
+}
+
+void ValueNumbering::rewriteCompound(NodeCompoundStatement& compound) {
+    for (auto& statement : compound.statements) {
+        std::visit([&](auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+            if constexpr (std::is_same_v<T, NodeStatementReturn>) {
+                if (stmt.expression.has_value()) {
+                    rewriteExpression(stmt.expression.value(), statement);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementVarDecl>) {
+                if (stmt.initializer.has_value()) {
+                    rewriteExpression(stmt.initializer.value(), statement);
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementAssignment>) {
+                rewriteExpression(stmt.expression, statement);
+            } else if constexpr (std::is_same_v<T, NodeStatementIf>) {
+                rewriteExpression(stmt.condition, statement);
+                rewriteCompound(*stmt.body);
+                if (stmt.elseBody.has_value()) {
+                    rewriteCompound(*stmt.elseBody.value());
+                }
+            } else if constexpr (std::is_same_v<T, NodeStatementWhile>) {
+                rewriteExpression(stmt.condition, statement);
+                rewriteCompound(*stmt.body);
+            }
+        }, statement.value);
+    }
+}
+
+void ValueNumbering::rewriteExpression(NodeExpression& expression, const NodeStatement& statement) {
+    // Innermost first, so a temporary computed inside another one is declared before it
+    std::visit([&](auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+        if constexpr (std::is_same_v<T, NodeExpressionPrimary>) {
+            if (auto* inner = std::get_if<std::unique_ptr<NodeExpression>>(&expr.value)) {
+                rewriteExpression(**inner, statement);
+            }
+        } else if constexpr (std::is_same_v<T, NodeExpressionFunctionCall>) {
+            for (auto& argument : expr.arguments) {
+                rewriteExpression(argument, statement);
+            }
+        } else {
+            rewriteExpression(*expr.left, statement);
+            rewriteExpression(*expr.right, statement);
+        }
+    }, expression.value);
+
+    if (auto it = reads.find(&expression); it != reads.end()) {
+        expression = makeIdentifier(it->second);
+    } else if (auto it = temporaries.find(&expression); it != temporaries.end()) {
+        NodeStatementVarDecl declaration{it->second, std::move(expression)};
+        insertions[&statement].push_back(NodeStatement{std::move(declaration)});
+        expression = makeIdentifier(it->second);
+    }
+}
+
+bool ValueNumbering::insertDeclarations(NodeCompoundStatement& compound) {
+    bool changed = false;
+
+    // Nested blocks first: the statements of this block move once it is rebuilt
+    for (auto& statement : compound.statements) {
+        if (auto* ifStmt = std::get_if<NodeStatementIf>(&statement.value)) {
+            changed |= insertDeclarations(*ifStmt->body);
+            if (ifStmt->elseBody.has_value()) {
+                changed |= insertDeclarations(*ifStmt->elseBody.value());
+            }
+        } else if (auto* whileStmt = std::get_if<NodeStatementWhile>(&statement.value)) {
+            changed |= insertDeclarations(*whileStmt->body);
+        }
+    }
+
+    bool inserting = std::any_of(compound.statements.begin(), compound.statements.end(), [this](const NodeStatement& statement) {
+        return insertions.count(&statement) > 0;
+    });
+    if (!inserting) {
+        return changed;
+    }
+
+    std::vector<NodeStatement> statements;
+    for (auto& statement : compound.statements) {
+        if (auto it = insertions.find(&statement); it != insertions.end()) {
+            for (auto& declaration : it->second) {
+                statements.push_back(std::move(declaration));
+            }
+        }
+        statements.push_back(std::move(statement));
+    }
+    compound.statements = std::move(statements);
+    return true;
+}
+
+} // namespace opt
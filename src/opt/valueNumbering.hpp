@@ -0,0 +1,92 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include "../codegen/passManager.hpp"
+#include "../ir/ir.hpp"
+
+namespace opt {
+
+/* Common subexpression elimination by value numbering on the SSA IR. Two instructions get the
+   same number when they apply the same operator to operands with the same numbers; an SSA
+   value never changes, so an assignment to an operand in between gives it a new number and
+   nothing has to be killed. Locally (-O1) only an earlier computation of the same block is
+   reused, globally (-O2) any computation whose block dominates, found walking the dominator
+   tree with scoped tables.
+   The AST keeps the result: the first occurrence is computed once into a new local declared
+   right before its statement, or left in the variable it initializes when that variable is
+   never assigned, and the redundant occurrences read it. Arithmetic is reused, and so are calls
+   to functions without side effects: the first call returned, so an identical one would too.
+   Nothing is computed into a local from a loop condition, which runs once per iteration. */
+class ValueNumbering : public codegen::Pass {
+public:
+    explicit ValueNumbering(bool global);
+
+    const char* name() const override;
+    bool run(NodeProgram& program, codegen::AnalysisCache& analyses, codegen::Statistics& statistics) override;
+
+private:
+    // Operator and operand numbers, commutative operands sorted
+    struct Key {
+        ir::Opcode opcode;
+        int64_t extra;  // Constant value, comparison or phi block
+        std::string callee;
+        std::vector<int> operands;
+
+        bool operator<(const Key& other) const;
+    };
+
+    // Where an expression of the AST sits
+    struct Site {
+        const NodeStatement* statement;
+        const NodeExpression* parent;  // Null at the root of the statement's expression
+        bool repeated;                 // In a while condition
+        int size;                      // Nodes of the expression tree
+    };
+
+    // Statement position as (compound, index) pairs from the function body down
+    using Path = std::vector<std::pair<const NodeCompoundStatement*, size_t>>;
+
+    struct Redundancy {
+        const NodeExpression* leader;
+        std::vector<const NodeExpression*> followers;
+    };
+
+    bool global;
+    const CallGraph* callGraph;
+
+    std::vector<int> numbers;  // Value number of every SSA value
+    std::map<Key, int> numbering;
+    std::unordered_map<const NodeExpression*, Site> sites;
+    std::unordered_map<const NodeStatement*, Path> paths;
+    std::unordered_map<std::string, int> declarations;  // Parameters and locals by name
+    std::unordered_map<std::string, int> assignments;
+
+    // What to rewrite, decided for the whole program before the AST changes
+    std::unordered_map<const NodeExpression*, std::string> reads;        // Becomes a read of the variable
+    std::unordered_map<const NodeExpression*, std::string> temporaries;  // Computed into a new local
+    std::unordered_map<const NodeStatement*, std::vector<NodeStatement>> insertions;
+
+    int expressionsReused;
+    int temporariesAdded;
+    int variablesReused;
+
+    bool isReusable(const ir::Instruction& instruction) const;
+    void numberValues(const ir::Function& function);
+    std::vector<Redundancy> findRedundancies(const ir::Function& function);
+    void planRewrites(std::vector<Redundancy> redundancies);
+
+    void collectCompound(const NodeCompoundStatement& compound, Path& path);
+    int collectExpression(const NodeExpression& expression, const NodeExpression* parent, const NodeStatement* statement,
+                          bool repeated);
+    bool insideAny(const NodeExpression* expression, const std::unordered_set<const NodeExpression*>& roots) const;
+    bool visibleFrom(const NodeStatement* leader, const NodeStatement* follower, bool strictlyAfter) const;
+    const std::string* heldBy(const NodeExpression& leader) const;
+
+    void rewriteCompound(NodeCompoundStatement& compound);
+    void rewriteExpression(NodeExpression& expression, const NodeStatement& statement);
+    bool insertDeclarations(NodeCompoundStatement& compound);
+};
+
+} // namespace opt
@@ -58,6 +58,7 @@ struct NodeStatementReturn {
 struct NodeStatementVarDecl {
     std::string identifier;
     std::optional<NodeExpression> initializer;
+    bool zeroed = true;  // Without an initializer; cleared when nothing can read the zero
 };
 
 struct NodeStatementAssignment {
@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # Test script for very-small-c-compiler
-# Usage: ./test.sh
+# Usage: ./test.sh [vscc flags...]   (e.g. ./test.sh -Os)
 
 # Colors for output
 RED='\033[0;31m'
@@ -9,6 +9,9 @@ GREEN='\033[0;32m'
 YELLOW='\033[1;33m'
 NC='\033[0m' # No Color
 
+# Flags passed to every compilation
+VSCC_FLAGS=("$@")
+
 # Test results
 PASSED=0
 FAILED=0
@@ -34,7 +37,7 @@ run_test() {
     rm -f gcc_test_output
     
     # Run our compiler and capture its exit code
-    ./bin/vscc "$test_file" > /dev/null 2>&1
+    ./bin/vscc "$test_file" "${VSCC_FLAGS[@]}" > /dev/null 2>&1
     actual_exit_code=$?
     
     TOTAL=$((TOTAL + 1))
@@ -97,6 +100,26 @@ run_test "examples/sample25.c" "[sample25] Function definition and call"
 run_test "examples/sample26.c" "[sample26] Complex function calls without parameters"
 run_test "examples/sample27.c" "[sample27] Simple function call with parameters"
 run_test "examples/sample28.c" "[sample28] Recursive function calls - Fibonacci sequence"
+run_test "examples/sample29.c" "[sample29] Register pressure with locals live across calls"
+run_test "examples/sample30.c" "[sample30] Expression trees deeper than the temporary register pool"
+run_test "examples/sample31.c" "[sample31] Immediate, memory, lea and inc/dec instruction patterns"
+run_test "examples/sample32.c" "[sample32] Values kept in registers across calls with known clobbers"
+run_test "examples/sample33.c" "[sample33] Frameless functions and red-zone stack slots"
+run_test "examples/sample34.c" "[sample34] If-conversion of single-assignment diamonds and triangles"
+run_test "examples/sample35.c" "[sample35] Constant folding and algebraic identities"
+run_test "examples/sample36.c" "[sample36] Sparse conditional constant propagation"
+run_test "examples/sample37.c" "[sample37] Strength reduced multiply and divide against imul and idiv"
+run_test "examples/sample38.c" "[sample38] Dead code after returns and decided branches"
+run_test "examples/sample39.c" "[sample39] Dead stores, unread variables and implicit zeros"
+run_test "examples/sample40.c" "[sample40] Redundant expressions reused by value numbering"
+run_test "examples/sample41.c" "[sample41] Pure and constant functions, reused calls"
+run_test "examples/sample42.c" "[sample42] Inlined calls with several returns and nested scopes"
+run_test "examples/sample43.c" "[sample43] Tail calls, accumulated recursion and sibling calls"
+run_test "examples/sample44.c" "[sample44] Recursive functions of several arguments, memoizable"
+run_test "examples/sample45.c" "[sample45] Calls specialized for their constant arguments"
+run_test "examples/sample46.c" "[sample46] Functions main never reaches removed"
+run_test "examples/sample47.c" "[sample47] Inlined parameters shadowed after a use"
+run_test "examples/sample48.c" "[sample48] Dead parameters in front of live ones"
 
 echo
 echo "========================================"
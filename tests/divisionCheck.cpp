@@ -0,0 +1,203 @@
+// Runs the division sequence the selector emits for each sampled divisor on every int dividend
+// and compares it with truncating division, as idiv computes it. The compile-time checks in
+// strengthReduction.cpp only try the dividends where plans go wrong first.
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "codegen/strengthReduction.hpp"
+
+namespace {
+
+enum class Opcode { Mov, Imul, Sar, Shr, Add, Neg };
+
+// One line of a division template; operands are rax (0), rcx (1) or an immediate
+struct Instruction {
+    Opcode opcode;
+    int destination;
+    int source;  // -1 for an immediate
+    int64_t immediate;
+};
+
+int registerIndex(const std::string& operand) {
+    if (operand == "rax") {
+        return 0;
+    }
+    if (operand == "rcx") {
+        return 1;
+    }
+    return -1;
+}
+
+std::vector<Instruction> decode(const std::string& sequence) {
+    std::vector<Instruction> program;
+    std::istringstream lines(sequence);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string mnemonic, destination, source;
+        words >> mnemonic >> destination >> source;
+        if (!destination.empty() && destination.back() == ',') {
+            destination.pop_back();
+        }
+
+        Instruction instruction{Opcode::Mov, registerIndex(destination), registerIndex(source), 0};
+        if (mnemonic == "mov") {
+            instruction.opcode = Opcode::Mov;
+        } else if (mnemonic == "imul") {
+            instruction.opcode = Opcode::Imul;
+        } else if (mnemonic == "sar") {
+            instruction.opcode = Opcode::Sar;
+        } else if (mnemonic == "shr") {
+            instruction.opcode = Opcode::Shr;
+        } else if (mnemonic == "add") {
+            instruction.opcode = Opcode::Add;
+        } else if (mnemonic == "neg") {
+            instruction.opcode = Opcode::Neg;
+        } else {
+            throw std::runtime_error("[divisionCheck::decode] Unknown instruction: " + line);
+        }
+        if (instruction.destination < 0 || (instruction.opcode != Opcode::Neg && source.empty())) {
+            throw std::runtime_error("[divisionCheck::decode] Unknown operands: " + line);
+        }
+        if (!source.empty() && instruction.source < 0) {
+            instruction.immediate = std::stoll(source);
+        }
+        program.push_back(instruction);
+    }
+    return program;
+}
+
+constexpr size_t batchSize = 4096;
+
+/* Dividends with the quotient idiv gives for them, run through the sequence a batch at a time:
+   each instruction goes over the whole batch, so decoding costs little per dividend. Unsigned
+   arithmetic wraps like the hardware does; sar goes through a signed value. */
+class Batch {
+public:
+    explicit Batch(const std::vector<Instruction>& program) : program(program), count(0), mismatches(0), firstMismatch(0) {}
+
+    void add(int64_t dividend, int64_t quotient) {
+        dividends[count] = dividend;
+        expected[count] = quotient;
+        if (++count == batchSize) {
+            flush();
+        }
+    }
+
+    void flush() {
+        const size_t n = count;
+        uint64_t* registers[2] = {rax, rcx};
+        for (size_t i = 0; i < n; i++) {
+            rax[i] = static_cast<uint64_t>(dividends[i]);
+            rcx[i] = 0;
+        }
+        for (const Instruction& instruction : program) {
+            uint64_t* destination = registers[instruction.destination];
+            const uint64_t* source = instruction.source >= 0 ? registers[instruction.source] : nullptr;
+            const uint64_t immediate = static_cast<uint64_t>(instruction.immediate);
+            switch (instruction.opcode) {
+                case Opcode::Mov:
+                    if (source) {
+                        std::copy(source, source + n, destination);
+                    } else {
+                        std::fill(destination, destination + n, immediate);
+                    }
+                    break;
+                case Opcode::Imul:
+                    if (source) {
+                        for (size_t i = 0; i < n; i++) destination[i] *= source[i];
+                    } else {
+                        for (size_t i = 0; i < n; i++) destination[i] *= immediate;
+                    }
+                    break;
+                case Opcode::Add:
+                    if (source) {
+                        for (size_t i = 0; i < n; i++) destination[i] += source[i];
+                    } else {
+                        for (size_t i = 0; i < n; i++) destination[i] += immediate;
+                    }
+                    break;
+                case Opcode::Shr:
+                    for (size_t i = 0; i < n; i++) destination[i] >>= immediate;
+                    break;
+                case Opcode::Sar:
+                    for (size_t i = 0; i < n; i++) {
+                        destination[i] = static_cast<uint64_t>(static_cast<int64_t>(destination[i]) >> immediate);
+                    }
+                    break;
+                case Opcode::Neg:
+                    for (size_t i = 0; i < n; i++) destination[i] = 0 - destination[i];
+                    break;
+            }
+        }
+        int64_t wrong = 0;
+        for (size_t i = 0; i < n; i++) {
+            wrong += static_cast<int64_t>(rax[i]) != expected[i];
+        }
+        if (wrong > 0 && mismatches == 0) {
+            size_t first = 0;
+            while (static_cast<int64_t>(rax[first]) == expected[first]) {
+                first++;
+            }
+            firstMismatch = dividends[first];
+        }
+        mismatches += wrong;
+        count = 0;
+    }
+
+    int64_t getMismatches() const { return mismatches; }
+    int64_t getFirstMismatch() const { return firstMismatch; }
+
+private:
+    const std::vector<Instruction>& program;
+    int64_t dividends[batchSize];
+    int64_t expected[batchSize];
+    uint64_t rax[batchSize];
+    uint64_t rcx[batchSize];
+    size_t count;
+    int64_t mismatches;
+    int64_t firstMismatch;
+};
+
+/* Walks the dividends a quotient at a time, so no idiv is needed for the expected value: with
+   truncation, x / |d| is q for x in [q|d|, q|d| + |d| - 1] when q > 0, for |x| < |d| when q = 0
+   and for x in [q|d| - |d| + 1, q|d|] when q < 0 */
+void checkAllDividends(Batch& batch, int64_t divisor) {
+    int64_t magnitude = divisor < 0 ? -divisor : divisor;
+    for (int64_t quotient = isel::intMin / magnitude; quotient <= isel::intMax / magnitude; quotient++) {
+        int64_t low = quotient > 0 ? quotient * magnitude : quotient * magnitude - magnitude + 1;
+        int64_t high = quotient < 0 ? quotient * magnitude : quotient * magnitude + magnitude - 1;
+        int64_t expected = divisor < 0 ? -quotient : quotient;
+        for (int64_t dividend = std::max(low, isel::intMin); dividend <= std::min(high, isel::intMax); dividend++) {
+            batch.add(dividend, expected);
+        }
+    }
+    batch.flush();
+}
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    for (int64_t divisor : isel::sampledConstants) {
+        std::vector<Instruction> program = decode(isel::divisionTemplate(isel::planDivision(divisor)));
+        auto batch = std::make_unique<Batch>(program);
+        checkAllDividends(*batch, divisor);
+
+        std::cout << "divisor " << divisor << ": ";
+        if (batch->getMismatches() == 0) {
+            std::cout << "all 2^32 dividends match" << std::endl;
+        } else {
+            int64_t first = batch->getFirstMismatch();
+            std::cout << batch->getMismatches() << " mismatches, first at " << first << " (" << first << " / "
+                      << divisor << " = " << first / divisor << ")" << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}